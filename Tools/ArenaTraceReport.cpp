@@ -0,0 +1,222 @@
+/* ==========================================================================
+   $File: ArenaTraceReport.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Reads an arena trace (see libSrc/ArenaStats.hpp) and prints, per
+   arena, the peak bytes in use and the most pushed in a single frame, plus
+   bytes by call site. With --folded it prints "arena;file:line bytes"
+   lines instead, for flamegraph.pl or speedscope.
+
+     g++ -std=c++11 -O2 ArenaTraceReport.cpp -o ArenaTraceReport
+     ./ArenaTraceReport [--folded] arena.trace
+   ========================================================================== */
+
+#include "../src/LethaniGlobalDefines.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+struct SiteTotals
+{
+    u64 pushes;
+    u64 bytes;
+    u64 waste;
+};
+
+struct ArenaTotals
+{
+    u64 peak;
+    u64 pushes;
+    u64 bytes;
+    u64 waste;
+    /// Bytes pushed in the current frame, and the most in any one frame
+    u64 frameBytes;
+    u64 maxFrameBytes;
+    std::map<std::string, SiteTotals> sites;
+};
+
+FileScope bool Read(FILE* file, void* dest, size_t size)
+{
+    return fread(dest, 1, size, file) == size;
+}
+
+template <typename T>
+FileScope bool Read(FILE* file, T* value)
+{
+    return Read(file, value, sizeof(T));
+}
+
+FileScope bool ReadName(FILE* file, std::string* name)
+{
+    u8 length;
+    char buf[256];
+    if (!Read(file, &length) || !Read(file, buf, length))
+        return false;
+    name->assign(buf, length);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    bool folded = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--folded") == 0)
+            folded = true;
+        else
+            path = argv[i];
+    }
+    if (!path)
+    {
+        fprintf(stderr, "Usage: %s [--folded] trace\n", argv[0]);
+        return 1;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return 1;
+    }
+
+    // NOTE(Chris): Arenas are merged by name across sessions (reloads),
+    // ids are only meaningful within one
+    std::map<std::string, ArenaTotals> arenas;
+    std::map<u16, std::string> arenaNames;
+    std::map<u32, std::string> siteNames;
+    u64 numFrames = 0;
+    u32 version = 0;
+    bool ok = true;
+
+    u8 type;
+    while (ok && Read(file, &type))
+    {
+        switch (type)
+        {
+        case 'A':
+        {
+            // NOTE(Chris): "ATRC" header, a new session
+            char rest[3];
+            u64 session;
+            ok = Read(file, rest, 3) && memcmp(rest, "TRC", 3) == 0
+                && Read(file, &version) && (version == 1 || version == 2)
+                && Read(file, &session);
+            arenaNames.clear();
+            siteNames.clear();
+        } break;
+
+        case 1:
+        {
+            u16 id;
+            std::string name;
+            ok = Read(file, &id) && ReadName(file, &name);
+            arenaNames[id] = name;
+            arenas[name];
+        } break;
+
+        case 2:
+        {
+            u32 id, line;
+            std::string name;
+            ok = Read(file, &id) && Read(file, &line) && ReadName(file, &name);
+            siteNames[id] = name + ":" + std::to_string(line);
+        } break;
+
+        case 3:
+        {
+            u16 arenaId;
+            u32 siteId, waste;
+            u64 size, used;
+            ok = Read(file, &arenaId) && Read(file, &siteId);
+            if (ok && version == 1)
+            {
+                // NOTE(Chris): Version 1 truncated size and waste
+                u32 size32;
+                u16 waste16;
+                ok = Read(file, &size32) && Read(file, &waste16);
+                size = size32;
+                waste = waste16;
+            }
+            else if (ok)
+            {
+                ok = Read(file, &size) && Read(file, &waste);
+            }
+            ok = ok && Read(file, &used);
+            if (!ok)
+                break;
+
+            ArenaTotals& arena = arenas[arenaNames[arenaId]];
+            arena.peak = std::max(arena.peak, used);
+            ++arena.pushes;
+            arena.bytes += size;
+            arena.waste += waste;
+            arena.frameBytes += size;
+
+            SiteTotals& site = arena.sites[siteNames[siteId]];
+            ++site.pushes;
+            site.bytes += size;
+            site.waste += waste;
+        } break;
+
+        case 4:
+        {
+            u64 frame;
+            ok = Read(file, &frame);
+            ++numFrames;
+            for (auto& entry : arenas)
+            {
+                ArenaTotals& arena = entry.second;
+                arena.maxFrameBytes = std::max(arena.maxFrameBytes, arena.frameBytes);
+                arena.frameBytes = 0;
+            }
+        } break;
+
+        default:
+            fprintf(stderr, "Unknown record %u, trace is corrupt\n", type);
+            ok = false;
+            break;
+        }
+    }
+    fclose(file);
+    if (!ok)
+        fprintf(stderr, "Trace ended early, reporting what was read\n");
+
+    for (auto& entry : arenas)
+    {
+        const ArenaTotals& arena = entry.second;
+        std::vector<std::pair<std::string, SiteTotals>> sites(arena.sites.begin(),
+                                                              arena.sites.end());
+        std::sort(sites.begin(), sites.end(),
+                  [](const std::pair<std::string, SiteTotals>& a,
+                     const std::pair<std::string, SiteTotals>& b)
+                  { return a.second.bytes > b.second.bytes; });
+
+        if (folded)
+        {
+            for (auto& site : sites)
+                printf("%s;%s %llu\n", entry.first.c_str(), site.first.c_str(),
+                       (unsigned long long)site.second.bytes);
+            continue;
+        }
+
+        printf("Arena %s: peak %llu bytes, %llu pushes, %llu bytes pushed, %llu lost to alignment\n",
+               entry.first.c_str(), (unsigned long long)arena.peak,
+               (unsigned long long)arena.pushes, (unsigned long long)arena.bytes,
+               (unsigned long long)arena.waste);
+        if (numFrames)
+            printf("  %llu frames, at most %llu bytes pushed in one frame\n",
+                   (unsigned long long)numFrames, (unsigned long long)arena.maxFrameBytes);
+        for (auto& site : sites)
+            printf("  %12llu bytes %8llu pushes %8llu waste  %s\n",
+                   (unsigned long long)site.second.bytes, (unsigned long long)site.second.pushes,
+                   (unsigned long long)site.second.waste, site.first.c_str());
+    }
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,105 @@
+// -*- c++ -*-
+#if !defined(ARENAALLOCATOR_H)
+/* ==========================================================================
+   $File: ArenaAllocator.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Lets standard containers allocate from a MemoryArena, to move code
+   over to the arenas a piece at a time:
+
+     ArenaAllocator<int> alloc(GetRegionArena(state, Region_Frame));
+     std::vector<int, ArenaAllocator<int>> v(alloc);
+
+   Deallocation is a no-op, memory comes back when the arena (or the
+   TempBlock the container was made in) is cleared, so the container
+   mustn't outlive that. Jasnah's Map/Filter carry the allocator of
+   their input over to their result.
+
+   In a C++17 build ArenaResource does the same for std::pmr.
+   ========================================================================== */
+
+#define ARENAALLOCATOR_H
+#include "../src/LethaniGlobalDefines.h"
+#include "MemoryLayout.hpp"
+#include <new>
+
+template <typename T>
+struct ArenaAllocator
+{
+    typedef T value_type;
+
+    MemoryArena* arena;
+
+    explicit ArenaAllocator(MemoryArena* arena)
+        : arena(arena)
+    {}
+
+    /// Allocate inside an open TempBlock, everything goes when it's cleared
+    explicit ArenaAllocator(const TempBlock& block)
+        : arena(block.arena)
+    {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : arena(other.arena)
+    {}
+
+    T* allocate(size_t num)
+    {
+        return PushArray<T>(arena, num, alignof(T) > 4 ? alignof(T) : 4);
+    }
+
+    void deallocate(T*, size_t)
+    {
+    }
+};
+
+template <typename T, typename U>
+inline bool
+operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+inline bool
+operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena != b.arena;
+}
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+
+class ArenaResource : public std::pmr::memory_resource
+{
+public:
+    explicit ArenaResource(MemoryArena* arena)
+        : arena(arena)
+    {}
+
+    MemoryArena* arena;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        return PushBlock(arena, bytes, alignment);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override
+    {
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+#endif
+#endif
+
+#endif
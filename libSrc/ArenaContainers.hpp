@@ -0,0 +1,338 @@
+// -*- c++ -*-
+#if !defined(ARENACONTAINERS_H)
+/* ==========================================================================
+   $File: ArenaContainers.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Containers that only ever allocate from a MemoryArena: a growable
+   array, an open-addressing hash map and a string builder. Nothing is
+   freed individually, outgrown storage is reclaimed along with the
+   arena (or the TempBlock it was made in), so per-frame use does no
+   malloc at all. Containers built in the persistent heap survive a
+   reload along with everything else there.
+
+   Elements are moved with memcpy, so they must be trivially copyable.
+   ========================================================================== */
+
+#define ARENACONTAINERS_H
+#include "../src/LethaniGlobalDefines.h"
+#include "MemoryLayout.hpp"
+#include <type_traits>
+#include <functional>
+#include <cstdarg>
+#include <cstdio>
+
+/// Grow a block pushed on arena from oldSize to newSize bytes. Extends
+/// it in place if nothing has been pushed since, otherwise pushes a new
+/// block and copies (the old one stays until the arena is cleared).
+inline void*
+ResizeArenaBlock(MemoryArena* arena, void* block, MemoryIndex oldSize, MemoryIndex newSize,
+                 MemoryIndex alignment ARENA_SITE_PARAM)
+{
+    // NOTE(Chris): The extension is pushed unaligned so it lands right
+    // after the block, and counts in the arena's stats like any push. A
+    // guarded push ends against its guard page, never at the top, so is
+    // always moved rather than extended
+    u8* top = arena->blockStart + arena->fillPoint;
+    if (block && static_cast<u8*>(block) + oldSize == top
+        && arena->fillPoint + (newSize - oldSize) <= arena->size)
+    {
+        PushBlockUnguarded(arena, newSize - oldSize, 1 ARENA_SITE_ARG);
+        return block;
+    }
+
+    void* result = PushBlock(arena, newSize, alignment ARENA_SITE_ARG);
+    if (block)
+        CopyBlock(result, block, oldSize);
+    return result;
+}
+
+template <typename T>
+struct ArenaArray
+{
+    static_assert(std::is_trivially_copyable<T>::value, "ArenaArray elements are memcpy'd");
+
+    MemoryArena* arena;
+    T* data;
+    u32 count;
+    u32 capacity;
+
+    T& operator[](u32 i) { assert(i < count); return data[i]; }
+    const T& operator[](u32 i) const { assert(i < count); return data[i]; }
+    T* begin() { return data; }
+    T* end() { return data + count; }
+    const T* begin() const { return data; }
+    const T* end() const { return data + count; }
+};
+
+template <typename T>
+inline void
+InitArray(ArenaArray<T>* array, MemoryArena* arena, u32 capacity = 0)
+{
+    array->arena = arena;
+    array->data = capacity ? PushArray<T>(arena, capacity, alignof(T)) : nullptr;
+    array->count = 0;
+    array->capacity = capacity;
+}
+
+template <typename T>
+inline void
+ArrayReserve(ArenaArray<T>* array, u32 capacity)
+{
+    if (capacity <= array->capacity)
+        return;
+
+    array->data = static_cast<T*>(ResizeArenaBlock(array->arena, array->data,
+                                                   array->capacity * sizeof(T),
+                                                   capacity * sizeof(T), alignof(T)));
+    array->capacity = capacity;
+}
+
+template <typename T>
+inline T*
+ArrayPush(ArenaArray<T>* array, const T& value)
+{
+    if (array->count == array->capacity)
+        ArrayReserve(array, array->capacity ? 2 * array->capacity : 8);
+
+    T* slot = &array->data[array->count++];
+    *slot = value;
+    return slot;
+}
+
+template <typename T>
+inline void
+ArrayClear(ArenaArray<T>* array)
+{
+    array->count = 0;
+}
+
+/// Default hash, std::hash scrambled as that's the identity for integers
+/// on most standard libraries, which probes terribly in a power of 2 table
+template <typename K>
+struct ArenaHash
+{
+    u64 operator()(const K& key) const
+    {
+        return HashMix(std::hash<K>()(key));
+    }
+};
+
+template <typename K, typename V, typename Hash = ArenaHash<K>>
+struct ArenaHashMap
+{
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                  "ArenaHashMap entries are memcpy'd");
+
+    enum : u8
+    {
+        Empty = 0,
+        Full = 1,
+        Removed = 2,
+    };
+
+    MemoryArena* arena;
+    /// Power of 2
+    u32 capacity;
+    u32 count;
+    /// Full + Removed, as both lengthen probes
+    u32 used;
+    u8* states;
+    K* keys;
+    V* values;
+};
+
+template <typename K, typename V, typename Hash>
+inline void
+InitHashMap(ArenaHashMap<K, V, Hash>* map, MemoryArena* arena, u32 capacity = 16)
+{
+    u32 pow2 = 8;
+    while (pow2 < capacity)
+        pow2 *= 2;
+
+    map->arena = arena;
+    map->capacity = pow2;
+    map->count = 0;
+    map->used = 0;
+    map->states = PushArray<u8>(arena, pow2, 1);
+    ZeroBlock(map->states, pow2);
+    map->keys = PushArray<K>(arena, pow2, alignof(K));
+    map->values = PushArray<V>(arena, pow2, alignof(V));
+}
+
+/// Slot holding key, or the slot it should be inserted at
+template <typename K, typename V, typename Hash>
+inline u32
+HashMapProbe(const ArenaHashMap<K, V, Hash>* map, const K& key, bool* found)
+{
+    typedef ArenaHashMap<K, V, Hash> Map;
+    u32 mask = map->capacity - 1;
+    u32 index = (u32)Hash()(key) & mask;
+    u32 insertAt = map->capacity;
+
+    // NOTE(Chris): The load factor is kept below 1, so there's always
+    // an Empty slot to stop at
+    while (map->states[index] != Map::Empty)
+    {
+        if (map->states[index] == Map::Full && map->keys[index] == key)
+        {
+            *found = true;
+            return index;
+        }
+        if (map->states[index] == Map::Removed && insertAt == map->capacity)
+            insertAt = index;
+        index = (index + 1) & mask;
+    }
+
+    *found = false;
+    return insertAt != map->capacity ? insertAt : index;
+}
+
+template <typename K, typename V, typename Hash>
+inline V*
+HashMapFind(ArenaHashMap<K, V, Hash>* map, const K& key)
+{
+    bool found;
+    u32 index = HashMapProbe(map, key, &found);
+    return found ? &map->values[index] : nullptr;
+}
+
+template <typename K, typename V, typename Hash>
+inline void
+HashMapRehash(ArenaHashMap<K, V, Hash>* map, u32 capacity)
+{
+    typedef ArenaHashMap<K, V, Hash> Map;
+    Map old = *map;
+    InitHashMap(map, old.arena, capacity);
+    for (u32 i = 0; i < old.capacity; ++i)
+    {
+        if (old.states[i] != Map::Full)
+            continue;
+
+        bool found;
+        u32 index = HashMapProbe(map, old.keys[i], &found);
+        map->states[index] = Map::Full;
+        map->keys[index] = old.keys[i];
+        map->values[index] = old.values[i];
+        ++map->count;
+        ++map->used;
+    }
+}
+
+/// Insert or overwrite, returning the stored value
+template <typename K, typename V, typename Hash>
+inline V*
+HashMapInsert(ArenaHashMap<K, V, Hash>* map, const K& key, const V& value)
+{
+    typedef ArenaHashMap<K, V, Hash> Map;
+    // NOTE(Chris): Max load 3/4. If it's mostly Removed slots rehash at
+    // the same size to clear them out
+    if (4 * (map->used + 1) > 3 * map->capacity)
+        HashMapRehash(map, 2 * map->count + 2 > map->capacity / 2 ? 2 * map->capacity : map->capacity);
+
+    bool found;
+    u32 index = HashMapProbe(map, key, &found);
+    if (!found)
+    {
+        if (map->states[index] == Map::Empty)
+            ++map->used;
+        map->states[index] = Map::Full;
+        map->keys[index] = key;
+        ++map->count;
+    }
+    map->values[index] = value;
+    return &map->values[index];
+}
+
+template <typename K, typename V, typename Hash>
+inline bool
+HashMapRemove(ArenaHashMap<K, V, Hash>* map, const K& key)
+{
+    typedef ArenaHashMap<K, V, Hash> Map;
+    bool found;
+    u32 index = HashMapProbe(map, key, &found);
+    if (!found)
+        return false;
+
+    map->states[index] = Map::Removed;
+    --map->count;
+    return true;
+}
+
+/// Always NUL terminated, so str.chars.data can go straight to C APIs
+struct StringBuilder
+{
+    ArenaArray<char> chars;
+};
+
+inline void
+InitStringBuilder(StringBuilder* str, MemoryArena* arena, u32 capacity = 64)
+{
+    InitArray(&str->chars, arena, capacity + 1);
+    str->chars.data[0] = 0;
+}
+
+inline const char*
+StringData(const StringBuilder* str)
+{
+    return str->chars.data;
+}
+
+inline u32
+StringLength(const StringBuilder* str)
+{
+    return str->chars.count;
+}
+
+inline void
+AppendString(StringBuilder* str, const char* src, u32 length)
+{
+    u32 needed = str->chars.count + length + 1;
+    if (needed > str->chars.capacity)
+        ArrayReserve(&str->chars, needed > 2 * str->chars.capacity ? needed : 2 * str->chars.capacity);
+
+    CopyBlock(str->chars.data + str->chars.count, src, length);
+    str->chars.count += length;
+    str->chars.data[str->chars.count] = 0;
+}
+
+inline void
+AppendString(StringBuilder* str, const char* src)
+{
+    AppendString(str, src, (u32)strlen(src));
+}
+
+inline void
+AppendFormat(StringBuilder* str, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+
+    u32 space = str->chars.capacity - str->chars.count;
+    int length = vsnprintf(str->chars.data + str->chars.count, space, format, args);
+    va_end(args);
+
+    if (length >= 0 && (u32)length >= space)
+    {
+        ArrayReserve(&str->chars, str->chars.count + (u32)length + 1);
+        vsnprintf(str->chars.data + str->chars.count, (u32)length + 1, format, argsCopy);
+    }
+    va_end(argsCopy);
+
+    if (length > 0)
+        str->chars.count += (u32)length;
+}
+
+inline void
+ClearString(StringBuilder* str)
+{
+    ArrayClear(&str->chars);
+    str->chars.data[0] = 0;
+}
+
+#endif
@@ -0,0 +1,346 @@
+// -*- c++ -*-
+#if !defined(ARENASTATS_H)
+/* ==========================================================================
+   $File: ArenaStats.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Optional instrumentation of arena pushes, to find out how much of
+   the heaps is actually used. Build with ARENA_INSTRUMENTATION defined
+   and attach an ArenaStats to an arena with AttachArenaStats; without
+   the define none of this is compiled into PushBlock.
+
+   Each ArenaStats keeps the arena's high-water mark, push/byte totals,
+   the bytes lost to alignment, and the same broken down by call site
+   (the file:line of the Push* call). Pushes can also be streamed to a
+   compact binary trace with OpenArenaTrace, which
+   Tools/ArenaTraceReport.cpp turns into a summary and folded stacks
+   for a flamegraph/treemap viewer.
+
+   Names are copied, not pointed to, as the stats may live in the heap
+   and outlast the library whose string literals they came from.
+
+   Arenas can be pushed to from several threads (scratch and frame
+   arenas), so every push is recorded under the trace's mutex. It's a
+   global lock, but only in instrumented builds.
+
+   Trace format, all little endian:
+     Header: "ATRC" u32 version u64 session
+     Records, each starting with a u8 ArenaTraceRecord:
+       Arena: u16 id, u8 length, name
+       Site:  u32 id, u32 line, u8 length, file
+       Push:  u16 arena, u32 site, u64 size, u32 waste, u64 used
+       Frame: u64 frameIndex
+   ========================================================================== */
+
+#define ARENASTATS_H
+#include "../src/LethaniGlobalDefines.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <chrono>
+
+struct ArenaCallSite
+{
+    const char* file;
+    u32 line;
+};
+
+#if defined(ARENA_INSTRUMENTATION)
+// NOTE(Chris): __builtin_FILE/LINE as a default argument give the
+// location of the caller, so Push* record where they were called from.
+// They have to be the whole default argument for that to happen
+#define ARENA_SITE_PARAM , const char* siteFile = __builtin_FILE(), u32 siteLine = __builtin_LINE()
+#define ARENA_SITE_DECL , const char* siteFile, u32 siteLine
+#define ARENA_SITE_ARG , siteFile, siteLine
+#else
+#define ARENA_SITE_PARAM
+#define ARENA_SITE_DECL
+#define ARENA_SITE_ARG
+#endif
+
+constexpr u32 ArenaStatsNameLength = 40;
+
+struct ArenaSiteStats
+{
+    /// Fast path match, re-resolved by name after a reload
+    const char* filePtr;
+    u32 line;
+    /// Id in the current trace, valid if traceSession matches
+    u32 traceId;
+    u64 traceSession;
+    u64 pushes;
+    u64 bytes;
+    u64 alignmentWaste;
+    char file[ArenaStatsNameLength];
+};
+
+struct ArenaStats
+{
+    static constexpr u32 MaxSites = 256;
+
+    char name[ArenaStatsNameLength];
+    MemoryIndex highWater;
+    u64 pushes;
+    u64 bytes;
+    u64 alignmentWaste;
+    /// Pushes that didn't fit in the site table
+    u64 untrackedPushes;
+
+    u16 traceId;
+    u64 traceSession;
+    ArenaSiteStats sites[MaxSites];
+};
+
+enum ArenaTraceRecord : u8
+{
+    ArenaTraceRecord_Arena = 1,
+    ArenaTraceRecord_Site = 2,
+    ArenaTraceRecord_Push = 3,
+    ArenaTraceRecord_Frame = 4,
+};
+
+constexpr u32 ArenaTraceVersion = 2;
+
+struct ArenaTrace
+{
+    FILE* file;
+    /// Distinguishes this trace from any other a stats block has seen
+    u64 session;
+    u32 nextSite;
+    u16 nextArena;
+    std::mutex mutex;
+    MemoryIndex fill;
+    u8 buffer[64 * 1024];
+};
+
+inline ArenaTrace*
+GetArenaTrace()
+{
+    LocalPersist ArenaTrace trace;
+    return &trace;
+}
+
+inline void
+CopyStatsName(char* dest, const char* src)
+{
+    // NOTE(Chris): Keep the end of long paths, it's the useful part
+    size_t length = strlen(src);
+    if (length >= ArenaStatsNameLength)
+        src += length - (ArenaStatsNameLength - 1);
+    strncpy(dest, src, ArenaStatsNameLength - 1);
+    dest[ArenaStatsNameLength - 1] = 0;
+}
+
+inline void
+InitArenaStats(ArenaStats* stats, const char* name)
+{
+    memset(stats, 0, sizeof(ArenaStats));
+    CopyStatsName(stats->name, name);
+}
+
+inline void
+FlushArenaTrace(ArenaTrace* trace)
+{
+    if (trace->file && trace->fill)
+        fwrite(trace->buffer, 1, trace->fill, trace->file);
+    trace->fill = 0;
+}
+
+inline void
+WriteArenaTrace(ArenaTrace* trace, const void* data, MemoryIndex size)
+{
+    if (trace->fill + size > sizeof(trace->buffer))
+        FlushArenaTrace(trace);
+    memcpy(trace->buffer + trace->fill, data, size);
+    trace->fill += size;
+}
+
+template <typename T>
+inline void
+WriteArenaTrace(ArenaTrace* trace, const T& value)
+{
+    WriteArenaTrace(trace, &value, sizeof(T));
+}
+
+inline void
+WriteArenaTraceName(ArenaTrace* trace, const char* name)
+{
+    u8 length = (u8)strlen(name);
+    WriteArenaTrace(trace, length);
+    WriteArenaTrace(trace, name, length);
+}
+
+/// Start streaming pushes (from every instrumented arena) to path.
+/// Appends, so a trace can span several reloads of the library.
+inline bool
+OpenArenaTrace(const char* path)
+{
+    ArenaTrace* trace = GetArenaTrace();
+    std::lock_guard<std::mutex> lock(trace->mutex);
+    if (trace->file)
+        return true;
+
+    trace->file = fopen(path, "ab");
+    if (!trace->file)
+        return false;
+
+    trace->session = (u64)std::chrono::steady_clock::now().time_since_epoch().count();
+    trace->nextSite = 1;
+    trace->nextArena = 1;
+    trace->fill = 0;
+    WriteArenaTrace(trace, "ATRC", 4);
+    WriteArenaTrace(trace, ArenaTraceVersion);
+    WriteArenaTrace(trace, trace->session);
+    return true;
+}
+
+inline void
+CloseArenaTrace()
+{
+    ArenaTrace* trace = GetArenaTrace();
+    std::lock_guard<std::mutex> lock(trace->mutex);
+    if (!trace->file)
+        return;
+
+    FlushArenaTrace(trace);
+    fclose(trace->file);
+    trace->file = nullptr;
+}
+
+/// Mark the start of a frame in the trace
+inline void
+ArenaTraceFrame(u64 frameIndex)
+{
+    ArenaTrace* trace = GetArenaTrace();
+    std::lock_guard<std::mutex> lock(trace->mutex);
+    if (!trace->file)
+        return;
+
+    WriteArenaTrace(trace, ArenaTraceRecord_Frame);
+    WriteArenaTrace(trace, frameIndex);
+}
+
+inline ArenaSiteStats*
+FindArenaSite(ArenaStats* stats, ArenaCallSite site)
+{
+    const char* file = strrchr(site.file, '/');
+    file = file ? file + 1 : site.file;
+
+    u32 mask = ArenaStats::MaxSites - 1;
+    u32 index = (site.line * 2654435761u) & mask;
+    for (u32 probe = 0; probe < ArenaStats::MaxSites; ++probe, index = (index + 1) & mask)
+    {
+        ArenaSiteStats* entry = &stats->sites[index];
+        if (entry->line == 0)
+        {
+            entry->filePtr = site.file;
+            entry->line = site.line;
+            CopyStatsName(entry->file, file);
+            return entry;
+        }
+        if (entry->line != site.line)
+            continue;
+        if (entry->filePtr == site.file)
+            return entry;
+        // NOTE(Chris): Same site from a reloaded library, or a
+        // different file with the same line
+        if (strncmp(entry->file, file, ArenaStatsNameLength - 1) == 0)
+        {
+            entry->filePtr = site.file;
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+/// Called by PushBlock for arenas with stats attached. used is the
+/// arena's total bytes in use after the push.
+inline void
+RecordArenaPush(ArenaStats* stats, MemoryIndex size, MemoryIndex waste, MemoryIndex used,
+                ArenaCallSite site)
+{
+    ArenaTrace* trace = GetArenaTrace();
+    std::lock_guard<std::mutex> lock(trace->mutex);
+
+    ++stats->pushes;
+    stats->bytes += size;
+    stats->alignmentWaste += waste;
+    if (used > stats->highWater)
+        stats->highWater = used;
+
+    ArenaSiteStats* entry = FindArenaSite(stats, site);
+    if (!entry)
+    {
+        ++stats->untrackedPushes;
+        return;
+    }
+    ++entry->pushes;
+    entry->bytes += size;
+    entry->alignmentWaste += waste;
+
+    if (!trace->file)
+        return;
+
+    if (stats->traceSession != trace->session)
+    {
+        stats->traceSession = trace->session;
+        stats->traceId = trace->nextArena++;
+        WriteArenaTrace(trace, ArenaTraceRecord_Arena);
+        WriteArenaTrace(trace, stats->traceId);
+        WriteArenaTraceName(trace, stats->name);
+    }
+    if (entry->traceSession != trace->session)
+    {
+        entry->traceSession = trace->session;
+        entry->traceId = trace->nextSite++;
+        WriteArenaTrace(trace, ArenaTraceRecord_Site);
+        WriteArenaTrace(trace, entry->traceId);
+        WriteArenaTrace(trace, entry->line);
+        WriteArenaTraceName(trace, entry->file);
+    }
+
+    WriteArenaTrace(trace, ArenaTraceRecord_Push);
+    WriteArenaTrace(trace, stats->traceId);
+    WriteArenaTrace(trace, entry->traceId);
+    WriteArenaTrace(trace, (u64)size);
+    WriteArenaTrace(trace, (u32)waste);
+    WriteArenaTrace(trace, (u64)used);
+}
+
+/// Summary of stats, sites sorted by bytes pushed
+inline void
+PrintArenaStats(const ArenaStats* stats, FILE* out, u32 maxSites = 16)
+{
+    fprintf(out, "Arena %s: high water %zu bytes, %llu pushes, %llu bytes, %llu lost to alignment\n",
+            stats->name, (size_t)stats->highWater, (unsigned long long)stats->pushes,
+            (unsigned long long)stats->bytes, (unsigned long long)stats->alignmentWaste);
+
+    const ArenaSiteStats* order[ArenaStats::MaxSites];
+    u32 numSites = 0;
+    for (u32 i = 0; i < ArenaStats::MaxSites; ++i)
+    {
+        if (stats->sites[i].line == 0)
+            continue;
+        // NOTE(Chris): Insertion sort, this is a debug report
+        u32 j = numSites++;
+        for (; j > 0 && order[j - 1]->bytes < stats->sites[i].bytes; --j)
+            order[j] = order[j - 1];
+        order[j] = &stats->sites[i];
+    }
+
+    for (u32 i = 0; i < numSites && i < maxSites; ++i)
+    {
+        fprintf(out, "  %12llu bytes %8llu pushes %8llu waste  %s:%u\n",
+                (unsigned long long)order[i]->bytes, (unsigned long long)order[i]->pushes,
+                (unsigned long long)order[i]->alignmentWaste, order[i]->file, order[i]->line);
+    }
+    if (stats->untrackedPushes)
+        fprintf(out, "  %llu pushes from untracked sites\n",
+                (unsigned long long)stats->untrackedPushes);
+}
+
+#endif
@@ -9,62 +9,172 @@
 
 #define BASICMATH_H
 #include <cmath>
+#include <type_traits>
 #include "../src/LethaniGlobalDefines.h"
 
-union v2
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+/// The SIMD register a whole Vec fits in, if there is one
+template <typename T, u32 N>
+struct VecSimd
+{
+    typedef T Type[N];
+};
+
+#if defined(__SSE__)
+template <>
+struct VecSimd<f32, 4>
+{
+    typedef __m128 Type;
+};
+#endif
+
+#if defined(__AVX__)
+template <>
+struct VecSimd<f64, 4>
+{
+    typedef __m256d Type;
+};
+#endif
+
+/// N component vector. These are plain unions with no constructors, so
+/// they can overlap each other for swizzles (v3.xy etc.) and live in the
+/// heap structs. Build them with V2/V3/V4 or MakeVec.
+template <typename T, u32 N>
+union Vec
+{
+    T vals[N];
+
+    T& operator[](u32 i) { return vals[i]; }
+    const T& operator[](u32 i) const { return vals[i]; }
+};
+
+template <typename T>
+union Vec<T, 2>
 {
     struct
     {
-        f32 x, y;
+        T x, y;
     };
     struct
     {
-        f32 u, v;
+        T u, v;
     };
-    f32 vals[2];
+    T vals[2];
+
+    T& operator[](u32 i) { return vals[i]; }
+    const T& operator[](u32 i) const { return vals[i]; }
 };
 
-union v3
+template <typename T>
+union Vec<T, 3>
 {
     struct
     {
-        f32 x, y, z;
+        T x, y, z;
+    };
+    struct
+    {
+        T u, v, w;
+    };
+    struct
+    {
+        T r, g, b;
+    };
+    struct
+    {
+        T h, c, l;
+    };
+    struct
+    {
+        Vec<T, 2> xy;
+        T ignored0;
+    };
+    struct
+    {
+        T ignored1;
+        Vec<T, 2> yz;
     };
     struct
     {
-        f32 u, v, w;
+        Vec<T, 2> uv;
+        T ignored3;
     };
     struct
     {
-        f32 r, g, b;
+        T ignored4;
+        Vec<T, 2> vw;
     };
+    T vals[3];
+
+    T& operator[](u32 i) { return vals[i]; }
+    const T& operator[](u32 i) const { return vals[i]; }
+};
+
+/// Aligned to its whole size whichever SIMD type (if any) overlays it,
+/// so the layout of anything holding one doesn't depend on compiler flags
+template <typename T>
+union alignas(4 * sizeof(T)) Vec<T, 4>
+{
     struct
     {
-        f32 h, c, l;
+        T x, y, z, w;
     };
     struct
     {
-        v2 xy;
-        f32 ignored0;
+        T r, g, b, a;
     };
     struct
     {
-        f32 ignored1;
-        v2 yz;
+        Vec<T, 2> xy;
+        Vec<T, 2> zw;
     };
     struct
     {
-        v2 uv;
-        f32 ignored3;
+        T ignored0;
+        Vec<T, 2> yz;
+        T ignored1;
     };
     struct
     {
-        f32 ignored4;
-        v2 vw;
+        Vec<T, 3> xyz;
+        T ignored2;
     };
-    f32 vals[3];
+    struct
+    {
+        Vec<T, 3> rgb;
+        T ignored3;
+    };
+    struct
+    {
+        T ignored4;
+        Vec<T, 3> yzw;
+    };
+    T vals[4];
+    typename VecSimd<T, 4>::Type simd;
+
+    T& operator[](u32 i) { return vals[i]; }
+    const T& operator[](u32 i) const { return vals[i]; }
 };
 
+typedef Vec<f32, 2> v2;
+typedef Vec<f32, 3> v3;
+typedef Vec<f32, 4> v4;
+typedef Vec<f64, 2> v2d;
+typedef Vec<f64, 3> v3d;
+typedef Vec<f64, 4> v4d;
+typedef Vec<i32, 2> v2i;
+typedef Vec<i32, 3> v3i;
+typedef Vec<i32, 4> v4i;
+
+static_assert(alignof(v4) == 16 && alignof(v4d) == 32 && alignof(v4i) == 16,
+              "4 component vectors are aligned to their size");
+
 namespace Constant {
 /// pi 32
 const f32 Pi = 3.1415926535897931160f;
@@ -242,4 +352,287 @@ inline unsigned CountSetBits(unsigned value)
     return count;
 }
 
+// Vector math
+/// Stops the scalar of a Vec/scalar operation being deduced, so v3 * 2 works
+template <typename T>
+struct VecElement
+{
+    typedef T Type;
+};
+
+template <typename T>
+inline Vec<T, 2> MakeVec(T x, T y)
+{
+    Vec<T, 2> result;
+    result.x = x;
+    result.y = y;
+    return result;
+}
+
+template <typename T>
+inline Vec<T, 3> MakeVec(T x, T y, T z)
+{
+    Vec<T, 3> result;
+    result.x = x;
+    result.y = y;
+    result.z = z;
+    return result;
+}
+
+template <typename T>
+inline Vec<T, 4> MakeVec(T x, T y, T z, T w)
+{
+    Vec<T, 4> result;
+    result.x = x;
+    result.y = y;
+    result.z = z;
+    result.w = w;
+    return result;
+}
+
+/// Every component set to value
+template <typename T, u32 N>
+inline Vec<T, N> Splat(typename VecElement<T>::Type value)
+{
+    Vec<T, N> result;
+    for (u32 i = 0; i < N; ++i)
+        result.vals[i] = value;
+    return result;
+}
+
+inline v2 V2(f32 x, f32 y) { return MakeVec(x, y); }
+inline v3 V3(f32 x, f32 y, f32 z) { return MakeVec(x, y, z); }
+inline v3 V3(v2 xy, f32 z) { return MakeVec(xy.x, xy.y, z); }
+inline v4 V4(f32 x, f32 y, f32 z, f32 w) { return MakeVec(x, y, z, w); }
+inline v4 V4(v3 xyz, f32 w) { return MakeVec(xyz.x, xyz.y, xyz.z, w); }
+
+// NOTE(Chris): Component-wise, against another Vec or a scalar. The loops
+// are fixed length so the compiler unrolls (and often vectorises) them
+#define VEC_ARITHMETIC(Op)                                              \
+    template <typename T, u32 N>                                        \
+    inline Vec<T, N> operator Op(Vec<T, N> lhs, Vec<T, N> rhs)          \
+    {                                                                   \
+        Vec<T, N> result;                                               \
+        for (u32 i = 0; i < N; ++i)                                     \
+            result.vals[i] = lhs.vals[i] Op rhs.vals[i];                \
+        return result;                                                  \
+    }                                                                   \
+    template <typename T, u32 N>                                        \
+    inline Vec<T, N> operator Op(Vec<T, N> lhs, typename VecElement<T>::Type rhs) \
+    {                                                                   \
+        Vec<T, N> result;                                               \
+        for (u32 i = 0; i < N; ++i)                                     \
+            result.vals[i] = lhs.vals[i] Op rhs;                        \
+        return result;                                                  \
+    }                                                                   \
+    template <typename T, u32 N>                                        \
+    inline Vec<T, N> operator Op(typename VecElement<T>::Type lhs, Vec<T, N> rhs) \
+    {                                                                   \
+        Vec<T, N> result;                                               \
+        for (u32 i = 0; i < N; ++i)                                     \
+            result.vals[i] = lhs Op rhs.vals[i];                        \
+        return result;                                                  \
+    }                                                                   \
+    template <typename T, u32 N>                                        \
+    inline Vec<T, N>& operator Op##=(Vec<T, N>& lhs, Vec<T, N> rhs)     \
+    {                                                                   \
+        return lhs = lhs Op rhs;                                        \
+    }                                                                   \
+    template <typename T, u32 N>                                        \
+    inline Vec<T, N>& operator Op##=(Vec<T, N>& lhs, typename VecElement<T>::Type rhs) \
+    {                                                                   \
+        return lhs = lhs Op rhs;                                        \
+    }
+
+VEC_ARITHMETIC(+)
+VEC_ARITHMETIC(-)
+VEC_ARITHMETIC(*)
+VEC_ARITHMETIC(/)
+#undef VEC_ARITHMETIC
+
+template <typename T, u32 N>
+inline Vec<T, N> operator-(Vec<T, N> value)
+{
+    Vec<T, N> result;
+    for (u32 i = 0; i < N; ++i)
+        result.vals[i] = -value.vals[i];
+    return result;
+}
+
+/// Exact comparison, see Equals for floats
+template <typename T, u32 N>
+inline bool operator==(Vec<T, N> lhs, Vec<T, N> rhs)
+{
+    for (u32 i = 0; i < N; ++i)
+        if (lhs.vals[i] != rhs.vals[i])
+            return false;
+    return true;
+}
+
+template <typename T, u32 N>
+inline bool operator!=(Vec<T, N> lhs, Vec<T, N> rhs) { return !(lhs == rhs); }
+
+/// Check whether each component is equal within accuracy
+template <typename T, u32 N>
+inline bool Equals(Vec<T, N> lhs, Vec<T, N> rhs)
+{
+    for (u32 i = 0; i < N; ++i)
+        if (!Equals(lhs.vals[i], rhs.vals[i]))
+            return false;
+    return true;
+}
+
+template <typename T, u32 N>
+inline T Dot(Vec<T, N> lhs, Vec<T, N> rhs)
+{
+    T result = 0;
+    for (u32 i = 0; i < N; ++i)
+        result += lhs.vals[i] * rhs.vals[i];
+    return result;
+}
+
+template <typename T>
+inline Vec<T, 3> Cross(Vec<T, 3> lhs, Vec<T, 3> rhs)
+{
+    return MakeVec(lhs.y * rhs.z - lhs.z * rhs.y,
+                   lhs.z * rhs.x - lhs.x * rhs.z,
+                   lhs.x * rhs.y - lhs.y * rhs.x);
+}
+
+template <typename T, u32 N>
+inline T LengthSq(Vec<T, N> value) { return Dot(value, value); }
+
+/// Integer vectors give an f64 length
+template <typename T, u32 N>
+inline auto Length(Vec<T, N> value) -> decltype(std::sqrt(T()))
+{
+    return std::sqrt(LengthSq(value));
+}
+
+/// Unit vector in the direction of value, which mustn't be zero length
+template <typename T, u32 N>
+inline Vec<T, N> Normalize(Vec<T, N> value)
+{
+    static_assert(std::is_floating_point<T>::value, "Only floating point vectors can be normalized");
+    return value * (T(1) / Length(value));
+}
+
+/// Linear interpolation between two vectors
+template <typename T, u32 N>
+inline Vec<T, N> Lerp(Vec<T, N> lhs, Vec<T, N> rhs, typename VecElement<T>::Type t)
+{
+    return lhs * (T(1) - t) + rhs * t;
+}
+
+/// Component-wise minimum
+template <typename T, u32 N>
+inline Vec<T, N> Min(Vec<T, N> lhs, Vec<T, N> rhs)
+{
+    Vec<T, N> result;
+    for (u32 i = 0; i < N; ++i)
+        result.vals[i] = Min(lhs.vals[i], rhs.vals[i]);
+    return result;
+}
+
+/// Component-wise maximum
+template <typename T, u32 N>
+inline Vec<T, N> Max(Vec<T, N> lhs, Vec<T, N> rhs)
+{
+    Vec<T, N> result;
+    for (u32 i = 0; i < N; ++i)
+        result.vals[i] = Max(lhs.vals[i], rhs.vals[i]);
+    return result;
+}
+
+/// Component-wise absolute value
+template <typename T, u32 N>
+inline Vec<T, N> Abs(Vec<T, N> value)
+{
+    Vec<T, N> result;
+    for (u32 i = 0; i < N; ++i)
+        result.vals[i] = Abs(value.vals[i]);
+    return result;
+}
+
+/// Clamp every component to a range
+template <typename T, u32 N>
+inline Vec<T, N> Clamp(Vec<T, N> value, typename VecElement<T>::Type min,
+                       typename VecElement<T>::Type max)
+{
+    Vec<T, N> result;
+    for (u32 i = 0; i < N; ++i)
+        result.vals[i] = Clamp(value.vals[i], min, max);
+    return result;
+}
+
+// NOTE(Chris): Non-template overloads win over the generic versions
+// above, so these replace them for the vectors that fit a register
+#if defined(__SSE__)
+inline v4 V4Simd(__m128 simd)
+{
+    v4 result;
+    result.simd = simd;
+    return result;
+}
+
+inline v4 operator+(v4 lhs, v4 rhs) { return V4Simd(_mm_add_ps(lhs.simd, rhs.simd)); }
+inline v4 operator-(v4 lhs, v4 rhs) { return V4Simd(_mm_sub_ps(lhs.simd, rhs.simd)); }
+inline v4 operator*(v4 lhs, v4 rhs) { return V4Simd(_mm_mul_ps(lhs.simd, rhs.simd)); }
+inline v4 operator/(v4 lhs, v4 rhs) { return V4Simd(_mm_div_ps(lhs.simd, rhs.simd)); }
+inline v4 operator+(v4 lhs, f32 rhs) { return V4Simd(_mm_add_ps(lhs.simd, _mm_set1_ps(rhs))); }
+inline v4 operator-(v4 lhs, f32 rhs) { return V4Simd(_mm_sub_ps(lhs.simd, _mm_set1_ps(rhs))); }
+inline v4 operator*(v4 lhs, f32 rhs) { return V4Simd(_mm_mul_ps(lhs.simd, _mm_set1_ps(rhs))); }
+inline v4 operator/(v4 lhs, f32 rhs) { return V4Simd(_mm_div_ps(lhs.simd, _mm_set1_ps(rhs))); }
+inline v4 operator+(f32 lhs, v4 rhs) { return V4Simd(_mm_add_ps(_mm_set1_ps(lhs), rhs.simd)); }
+inline v4 operator-(f32 lhs, v4 rhs) { return V4Simd(_mm_sub_ps(_mm_set1_ps(lhs), rhs.simd)); }
+inline v4 operator*(f32 lhs, v4 rhs) { return V4Simd(_mm_mul_ps(_mm_set1_ps(lhs), rhs.simd)); }
+inline v4 operator/(f32 lhs, v4 rhs) { return V4Simd(_mm_div_ps(_mm_set1_ps(lhs), rhs.simd)); }
+inline v4 operator-(v4 value) { return V4Simd(_mm_sub_ps(_mm_setzero_ps(), value.simd)); }
+inline v4 Min(v4 lhs, v4 rhs) { return V4Simd(_mm_min_ps(lhs.simd, rhs.simd)); }
+inline v4 Max(v4 lhs, v4 rhs) { return V4Simd(_mm_max_ps(lhs.simd, rhs.simd)); }
+
+inline f32 Dot(v4 lhs, v4 rhs)
+{
+    __m128 products = _mm_mul_ps(lhs.simd, rhs.simd);
+    // NOTE(Chris): (0+1, 0+1, 2+3, 2+3) then add the high pair to the low
+    __m128 swapped = _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(products, swapped);
+    sums = _mm_add_ss(sums, _mm_movehl_ps(swapped, sums));
+    return _mm_cvtss_f32(sums);
+}
+#endif
+
+#if defined(__AVX__)
+inline v4d V4dSimd(__m256d simd)
+{
+    v4d result;
+    result.simd = simd;
+    return result;
+}
+
+inline v4d operator+(v4d lhs, v4d rhs) { return V4dSimd(_mm256_add_pd(lhs.simd, rhs.simd)); }
+inline v4d operator-(v4d lhs, v4d rhs) { return V4dSimd(_mm256_sub_pd(lhs.simd, rhs.simd)); }
+inline v4d operator*(v4d lhs, v4d rhs) { return V4dSimd(_mm256_mul_pd(lhs.simd, rhs.simd)); }
+inline v4d operator/(v4d lhs, v4d rhs) { return V4dSimd(_mm256_div_pd(lhs.simd, rhs.simd)); }
+inline v4d operator+(v4d lhs, f64 rhs) { return V4dSimd(_mm256_add_pd(lhs.simd, _mm256_set1_pd(rhs))); }
+inline v4d operator-(v4d lhs, f64 rhs) { return V4dSimd(_mm256_sub_pd(lhs.simd, _mm256_set1_pd(rhs))); }
+inline v4d operator*(v4d lhs, f64 rhs) { return V4dSimd(_mm256_mul_pd(lhs.simd, _mm256_set1_pd(rhs))); }
+inline v4d operator/(v4d lhs, f64 rhs) { return V4dSimd(_mm256_div_pd(lhs.simd, _mm256_set1_pd(rhs))); }
+inline v4d operator+(f64 lhs, v4d rhs) { return V4dSimd(_mm256_add_pd(_mm256_set1_pd(lhs), rhs.simd)); }
+inline v4d operator-(f64 lhs, v4d rhs) { return V4dSimd(_mm256_sub_pd(_mm256_set1_pd(lhs), rhs.simd)); }
+inline v4d operator*(f64 lhs, v4d rhs) { return V4dSimd(_mm256_mul_pd(_mm256_set1_pd(lhs), rhs.simd)); }
+inline v4d operator/(f64 lhs, v4d rhs) { return V4dSimd(_mm256_div_pd(_mm256_set1_pd(lhs), rhs.simd)); }
+inline v4d operator-(v4d value) { return V4dSimd(_mm256_sub_pd(_mm256_setzero_pd(), value.simd)); }
+inline v4d Min(v4d lhs, v4d rhs) { return V4dSimd(_mm256_min_pd(lhs.simd, rhs.simd)); }
+inline v4d Max(v4d lhs, v4d rhs) { return V4dSimd(_mm256_max_pd(lhs.simd, rhs.simd)); }
+
+inline f64 Dot(v4d lhs, v4d rhs)
+{
+    __m256d products = _mm256_mul_pd(lhs.simd, rhs.simd);
+    __m128d sums = _mm_add_pd(_mm256_castpd256_pd128(products), _mm256_extractf128_pd(products, 1));
+    sums = _mm_add_sd(sums, _mm_unpackhi_pd(sums, sums));
+    return _mm_cvtsd_f64(sums);
+}
+#endif
+
 #endif
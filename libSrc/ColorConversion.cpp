@@ -48,9 +48,8 @@ v3 HCLToRGB( v3 hcl )
         }
     };
 
-    x = LABConstants::Xn * LABXYZ( x );
-    y = LABConstants::Yn * LABXYZ( y );
-    z = LABConstants::Zn * LABXYZ( z );
+    v3 xyz = V3( LABXYZ( x ), LABXYZ( y ), LABXYZ( z ) );
+    xyz *= V3( LABConstants::Xn, LABConstants::Yn, LABConstants::Zn );
 
     // NOTE(Chris): XYZ to RGB
     auto XYZRGB = []( f32 r )
@@ -67,14 +66,11 @@ v3 HCLToRGB( v3 hcl )
     };
 
     v3 rgbOut;
-    rgbOut.r = XYZRGB( 3.2404542f * x - 1.5371385f * y - 0.4985314f * z );
-    rgbOut.g = XYZRGB( -0.9692660f * x + 1.8760108f * y + 0.0415560f * z );
-    rgbOut.b = XYZRGB( 0.0556434f * x - 0.2040259f * y + 1.0572252f * z );
+    rgbOut.r = XYZRGB( Dot( V3( 3.2404542f, -1.5371385f, -0.4985314f ), xyz ) );
+    rgbOut.g = XYZRGB( Dot( V3( -0.9692660f, 1.8760108f, 0.0415560f ), xyz ) );
+    rgbOut.b = XYZRGB( Dot( V3( 0.0556434f, -0.2040259f, 1.0572252f ), xyz ) );
 
-    for (int i = 0; i < 3; ++i)
-        rgbOut.vals[i] = Clamp(rgbOut.vals[i], 0.0f, 255.0f);
-
-    return rgbOut;
+    return Clamp( rgbOut, 0.0f, 255.0f );
 
 }
 
@@ -113,9 +109,9 @@ v3 RGBToHCL( v3 rgb )
 
     };
 
-    f32 x = XYZLAB( (0.4124564f * rgb.r + 0.3575761f * rgb.g + 0.1804375f * rgb.b) / LABConstants::Xn );
-    f32 y = XYZLAB( (0.2126729f * rgb.r + 0.7151522f * rgb.g + 0.0721750f * rgb.b) / LABConstants::Yn );
-    f32 z = XYZLAB( (0.0193339f * rgb.r + 0.1191920f * rgb.g + 0.9503041f * rgb.b) / LABConstants::Zn );
+    f32 x = XYZLAB( Dot( V3( 0.4124564f, 0.3575761f, 0.1804375f ), rgb ) / LABConstants::Xn );
+    f32 y = XYZLAB( Dot( V3( 0.2126729f, 0.7151522f, 0.0721750f ), rgb ) / LABConstants::Yn );
+    f32 z = XYZLAB( Dot( V3( 0.0193339f, 0.1191920f, 0.9503041f ), rgb ) / LABConstants::Zn );
 
     v3 hcl;
 
@@ -0,0 +1,110 @@
+// -*- c++ -*-
+#if !defined(HEAPPLAN_H)
+/* ==========================================================================
+   $File: HeapPlan.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Compile-time layout of a block of memory. A HeapPlan lays out a list
+   of items (a size and alignment each) in order, and its size, the
+   offset of each item and the alignment padding between them are all
+   constexpr. Layouts can then be checked with static_assert, and memory
+   reserved at exactly the size needed:
+
+     typedef HeapPlan<PlanArray<Foo>, PlanArray<Bar, 100>,
+                      PlanBytes<Megabytes(1), 4096>> Plan;
+     static_assert(Plan::Size() <= Megabytes(2), "Plan has outgrown its heap");
+     Bar* bars = (Bar*)(heap + Plan::Offset<1>());
+
+   Plans are items themselves, so can be nested. Offsets assume the block
+   starts aligned to Plan::Alignment().
+   ========================================================================== */
+
+#define HEAPPLAN_H
+#include "../src/LethaniGlobalDefines.h"
+#include <cstddef>
+
+constexpr std::size_t
+PlanAlignUp(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+constexpr std::size_t
+PlanMax(std::size_t a, std::size_t b)
+{
+    return a > b ? a : b;
+}
+
+/// Count blocks of Bytes, each starting Align aligned
+template <std::size_t Bytes, std::size_t Align = 64, std::size_t Count = 1>
+struct PlanBytes
+{
+    static_assert(Align != 0 && (Align & (Align - 1)) == 0, "Alignment must be a power of 2");
+
+    static constexpr std::size_t Size()
+    {
+        return Count == 0 ? 0 : (Count - 1) * PlanAlignUp(Bytes, Align) + Bytes;
+    }
+    static constexpr std::size_t Alignment() { return Align; }
+};
+
+template <typename T, std::size_t Count = 1, std::size_t Align = alignof(T)>
+struct PlanArray : PlanBytes<sizeof(T), Align, Count>
+{};
+
+/// Items laid out one after another from Start
+template <std::size_t Start, typename... Items>
+struct PlanLayout
+{
+    static constexpr std::size_t End() { return Start; }
+    static constexpr std::size_t Alignment() { return 1; }
+    /// Bytes in the items themselves, without padding
+    static constexpr std::size_t Used() { return 0; }
+};
+
+template <std::size_t Start, typename Item, typename... Rest>
+struct PlanLayout<Start, Item, Rest...>
+{
+    typedef PlanLayout<PlanAlignUp(Start, Item::Alignment()) + Item::Size(), Rest...> Next;
+
+    static constexpr std::size_t Offset() { return PlanAlignUp(Start, Item::Alignment()); }
+    static constexpr std::size_t ItemSize() { return Item::Size(); }
+    static constexpr std::size_t End() { return Next::End(); }
+    static constexpr std::size_t Alignment() { return PlanMax(Item::Alignment(), Next::Alignment()); }
+    static constexpr std::size_t Used() { return Item::Size() + Next::Used(); }
+};
+
+/// The layout from the Ith item on
+template <u32 I, typename Layout>
+struct PlanAt
+{
+    typedef typename PlanAt<I - 1, typename Layout::Next>::Type Type;
+};
+
+template <typename Layout>
+struct PlanAt<0, Layout>
+{
+    typedef Layout Type;
+};
+
+template <typename... Items>
+struct HeapPlan
+{
+    typedef PlanLayout<0, Items...> Layout;
+    enum : u32 { NumItems = sizeof...(Items) };
+
+    static constexpr std::size_t Size() { return Layout::End(); }
+    static constexpr std::size_t Alignment() { return Layout::Alignment(); }
+    /// Bytes lost to aligning the items
+    static constexpr std::size_t Padding() { return Layout::End() - Layout::Used(); }
+
+    template <u32 I>
+    static constexpr std::size_t Offset() { return PlanAt<I, Layout>::Type::Offset(); }
+    template <u32 I>
+    static constexpr std::size_t ItemSize() { return PlanAt<I, Layout>::Type::ItemSize(); }
+};
+
+#endif
@@ -1012,12 +1012,15 @@ namespace Jasnah
     }
 }
 #include <vector>
+#include <memory>
 namespace Jasnah
 {
     template <typename T, typename... TArgs, typename F>
     std::vector<T,TArgs...> FilterContainer(const std::vector<T,TArgs...>& ctr, const F& f)
     {
-        std::vector<T,TArgs...> result;
+        // NOTE(Chris): Allocate the result the same way as the input
+        // (e.g. from the same arena)
+        std::vector<T,TArgs...> result(ctr.get_allocator());
         result.reserve(ctr.size());
         for (const auto& x : ctr)
         {
@@ -1043,13 +1046,16 @@ namespace Jasnah
         return result;
     }
 
-    template <typename T, typename... TArgs, typename F>
+    template <typename T, typename Alloc, typename F>
     auto
-    MapToContainer(const std::vector<T, TArgs...>& ctr, const F& f)
-        -> std::vector<decltype(f(std::declval<T>()))>
+    MapToContainer(const std::vector<T, Alloc>& ctr, const F& f)
+        -> std::vector<decltype(f(std::declval<T>())),
+                       typename std::allocator_traits<Alloc>::template
+                       rebind_alloc<decltype(f(std::declval<T>()))>>
     {
         using ResType = decltype(f(std::declval<T>()));
-        std::vector<ResType> result;
+        using ResAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<ResType>;
+        std::vector<ResType, ResAlloc> result{ResAlloc(ctr.get_allocator())};
         result.reserve(ctr.size());
         for (const auto& x : ctr)
         {
@@ -9,10 +9,25 @@
 
 #define MEMORYLAYOUT_H
 #include "../src/LethaniGlobalDefines.h"
+#include "StateLayout.hpp"
+#include "HeapPlan.hpp"
 #include <cassert>
 #include <cstring>
+#include <atomic>
+#include <thread>
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include <SDL2/SDL.h>
 
+// NOTE(Chris): Debug-only guard pages, see PushGuardedBlock.
+// ARENA_GUARD_PAGES guards each sub-arena, ARENA_GUARD_PUSHES every push
+#if !defined(NDEBUG) && (defined(ARENA_GUARD_PAGES) || defined(ARENA_GUARD_PUSHES))
+#define ARENA_GUARDS 1
+#endif
+
 #define Kilobytes(value) ((value)*1024LL)
 #define Megabytes(value) (Kilobytes(value)*1024LL)
 #define Gigabytes(value) (Megabytes(value)*1024LL)
@@ -23,6 +38,114 @@
 using std::size_t;
 typedef std::size_t MemoryIndex;
 
+#include "ArenaStats.hpp"
+
+/// How the host paces calls to Update
+enum class FramePacing : u32
+{
+    /// Sleep/spin out the remainder of a fixed frame budget
+    Fixed,
+    /// No host-side wait, SDL_RenderPresent blocks on vsync
+    VSync,
+    /// Run Update back to back
+    Uncapped,
+};
+
+/// Per-frame timing filled in by the host before each Update
+struct FrameTiming
+{
+    FramePacing pacing;
+    u64 frameIndex;
+    /// Frame budget in seconds, 0 if uncapped/vsync
+    f64 targetSeconds;
+    /// Time spent in the previous Update
+    f64 updateSeconds;
+    /// Wall time of the previous frame, including any wait
+    f64 frameSeconds;
+    /// Number of frames that have overrun targetSeconds
+    u64 missedFrames;
+    /// Pages written during the previous frame, only filled in when the
+    /// host is run with --dirty-stats
+    u64 persistantDirtyPages;
+    u64 workingDirtyPages;
+};
+
+/// Events gathered by the host for a single frame. The host owns the
+/// SDL event queue so input can be recorded and replayed.
+struct FrameInput
+{
+    static constexpr u32 MaxEvents = 64;
+    u32 numEvents;
+    SDL_Event events[MaxEvents];
+};
+
+/// Actions the library can ask the host to perform after Update
+enum HostRequest : u32
+{
+    HostRequest_None = 0,
+    /// Write the persistent heap to the snapshot file
+    HostRequest_SaveSnapshot = 1 << 0,
+    /// Replace the persistent heap with the last snapshot
+    HostRequest_RestoreSnapshot = 1 << 1,
+    /// Step the input loop: idle -> recording -> playing -> idle
+    HostRequest_CycleInputLoop = 1 << 2,
+};
+
+/// Which of the CompleteState heaps a HeapRoot or MemoryRegion lives in
+enum class HeapId : u32
+{
+    Persistant,
+    Working,
+};
+
+/// When a region's arena is reset. Everything in a region shares its
+/// lifetime, so freeing all of it is a single ResetArena.
+enum class RegionLifetime : u32
+{
+    /// Never reset, lasts as long as the heap it's in
+    Permanent,
+    /// Reset by the library (ResetRegions) when it loads a new level
+    Level,
+    /// Reset by the host before every Update
+    Frame,
+    /// Reset by the library once it's done with the contents, e.g. after
+    /// uploading them to the GPU
+    Transient,
+    /// Backs the library's scratch and frame arenas, which threads keep
+    /// using across frames. ResetRegions never touches it
+    Working,
+};
+
+/// Index into CompleteState::regions
+enum RegionId : u32
+{
+    Region_Permanent,
+    Region_Level,
+    Region_Frame,
+    Region_GpuStaging,
+    /// General purpose working memory (scratch arenas etc.)
+    Region_Working,
+    Region_Count,
+};
+
+struct MemoryArena;
+
+/// A named span of one of the heaps, laid out by the host. The region's
+/// arena lives at the start of the span itself, so it's saved and
+/// restored along with the heap (snapshots, input loops) and always
+/// agrees with the region's contents.
+struct MemoryRegion
+{
+    const char* name;
+    RegionLifetime lifetime;
+    HeapId heap;
+    /// Offset of the region in its heap
+    MemoryIndex offset;
+    /// Including the arena header
+    MemoryIndex size;
+    MemoryArena* arena;
+};
+
 typedef struct CompleteState
 {
     /// Normal heap is fully persistent
@@ -31,8 +154,59 @@ typedef struct CompleteState
 
     MemoryIndex workingHeapSize;
     void* workingHeap;
+
+    FrameTiming timing;
+    FrameInput input;
+
+    /// Unique to this run of the host. Anything in the persistent heap
+    /// tied to OS resources (windows etc.) from a different session came
+    /// from a restored snapshot and must be recreated.
+    u64 sessionId;
+    /// NUMA node Update runs on and the persistent heap is bound to, -1
+    /// if the host isn't doing NUMA placement. Memory used by other
+    /// threads should be touched by them first to land on their node.
+    i32 numaNode;
+    /// Bitmask of HostRequest, cleared by the host once handled
+    u32 hostRequests;
+
+    /// Published by the host before the library is first loaded
+    MemoryRegion regions[Region_Count];
 } CompleteState;
 
+/// Where an arena gets more memory once its block is full
+enum class ArenaGrowth : u32
+{
+    /// Overflowing is an error (asserts)
+    Fixed,
+    /// Push new blocks onto another arena
+    FromArena,
+    /// mmap new blocks. Their addresses don't survive a restart, so only
+    /// for arenas whose contents don't need to either
+    FromMmap,
+};
+
+/// Written at the start of each chained block, holding the state of
+/// the block that was current before it
+struct ArenaBlockHeader
+{
+    u8* blockStart;
+    MemoryIndex size;
+    MemoryIndex fillPoint;
+    ArenaBlockHeader* prev;
+    /// growFrom's fillPoint before this block was pushed onto it
+    MemoryIndex growFromFillPoint;
+};
+
+/// Bookkeeping for a guard page, stored at the start of the guarded push
+struct ArenaGuard
+{
+    ArenaGuard* prev;
+    u8* page;
+    /// GetArenaBytesUsed before the push, the page is released once the
+    /// arena is rewound to here
+    MemoryIndex usedBefore;
+};
+
 struct MemoryArena
 {
     MemoryIndex size;
@@ -40,28 +214,174 @@ struct MemoryArena
     MemoryIndex fillPoint;
 
     i32 tempCount;
+
+    ArenaGrowth growth;
+    /// Smallest block to chain on, larger pushes get a block of their own
+    MemoryIndex minBlockSize;
+    /// Only used with ArenaGrowth::FromArena
+    MemoryArena* growFrom;
+    /// Header of the current block, nullptr while in the first one
+    ArenaBlockHeader* chain;
+    /// Only used with ARENA_INSTRUMENTATION, see ArenaStats.hpp
+    ArenaStats* stats;
+    /// Live guard pages, newest first. Only used with ARENA_GUARDS
+    ArenaGuard* guards;
+    /// Never guard pushes, for arenas in memory the host reads page by
+    /// page (the persistent heap, to snapshot it). Passed on to sub-arenas
+    bool noGuards;
 };
 
 struct TempBlock
 {
     MemoryArena* arena;
+    /// Block current when the TempBlock was made, later ones are freed
+    u8* blockStart;
     MemoryIndex fillPoint;
+    /// tempCount once this was made, TempBlocks must be cleared in the
+    /// reverse order they were created
+    i32 depth;
+};
+
+/// Per-thread arenas for memory that only has to last the frame. A
+/// thread claims one of these with GetScratchArena the first time it
+/// needs it, after which it allocates with the normal (unsynchronised)
+/// PushBlock. Claims are kept from frame to frame, so a thread always
+/// gets the arena it first touched (and placed on its NUMA node), until
+/// ReleaseScratchClaims. Meant for a fixed set of threads: one that
+/// exits keeps its arena.
+struct ScratchArenas
+{
+    static constexpr u32 MaxThreads = 32;
+    /// 0 until InitScratchArenas
+    MemoryIndex perThreadSize;
+    /// Changed by ReleaseScratchClaims, invalidating all claims
+    std::atomic<u64> epoch;
+    std::atomic<u32> numClaimed;
+    MemoryArena arenas[MaxThreads];
 };
 
-struct GameState
+/// N arenas used in turn, one per frame, so a consumer (e.g. a render
+/// thread) can read the last complete frame in place while the producer
+/// writes the next. An arena is only reset once nothing is reading the
+/// frame that was last in it, giving up to N - 1 frames of overlap.
+template <u32 N = 2>
+struct FrameArenas
+{
+    static_assert(N >= 2, "One frame arena can't be read and written at once");
+    MemoryArena arenas[N];
+    /// Owned by the producer
+    u64 writeFrame;
+    /// Frames below this are complete
+    std::atomic<u64> published;
+    /// 1 + the frame the consumer is reading, 0 if none
+    std::atomic<u64> reading;
+};
+
+/// A HEAP_STRUCT at a fixed offset in one of the heaps. The library
+/// lists these in LoopAPI so the host can migrate them when a reload
+/// changes their layout. The HeapRootHeader comes first, the struct
+/// itself HeapRootDataOffset bytes in.
+struct HeapRoot
+{
+    const StructLayout& (*layout)();
+    HeapId heap;
+    MemoryIndex offset;
+    /// Bytes reserved for header and struct, the struct can grow into
+    /// this without moving anything after it
+    MemoryIndex capacity;
+};
+
+constexpr MemoryIndex HeapRootDataOffset = (sizeof(HeapRootHeader) + 63) & ~(MemoryIndex)63;
+
+inline HeapRootHeader*
+GetHeapRootHeader(CompleteState* state, const HeapRoot& root)
+{
+    void* heap = root.heap == HeapId::Persistant ? state->persistantHeap : state->workingHeap;
+    return reinterpret_cast<HeapRootHeader*>(static_cast<u8*>(heap) + root.offset);
+}
+
+inline void*
+GetHeapRootData(CompleteState* state, const HeapRoot& root)
+{
+    return reinterpret_cast<u8*>(GetHeapRootHeader(state, root)) + HeapRootDataOffset;
+}
+
+/// The host has migrated (or initialised) every root before Update is
+/// called, so the layout should always match here
+template <typename T>
+inline T*
+GetHeapRoot(CompleteState* state, const HeapRoot& root)
+{
+    assert(GetHeapRootHeader(state, root)->signature == LayoutOf<T>::Signature);
+    return static_cast<T*>(GetHeapRootData(state, root));
+}
+
+#define GAME_STATE_FIELDS(Field)                                        \
+    Field(bool, initialized)                                            \
+    /* CompleteState::sessionId when window/renderer were created */    \
+    Field(u64, sessionId)                                               \
+    Field(f32, time)                                                    \
+    Field(SDL_Window*, window)                                          \
+    Field(SDL_Renderer*, renderer)
+HEAP_STRUCT(GameState, GAME_STATE_FIELDS);
+
+#define WORKING_STATE_FIELDS(Field)             \
+    Field(bool, initialized)                    \
+    Field(ScratchArenas, scratch)
+HEAP_STRUCT(WorkingState, WORKING_STATE_FIELDS);
+
+/// A HeapRoot's header and struct, with room for the struct to grow
+/// without anything after it moving
+template <typename T, MemoryIndex Capacity>
+struct PlanHeapRoot : PlanBytes<Capacity, 64>
 {
-    bool initialized;
-    f32 time;
-    SDL_Window* window;
-    SDL_Renderer* renderer;
+    static_assert(HeapRootDataOffset + sizeof(T) <= Capacity, "Heap root has outgrown its capacity");
 };
 
-struct WorkingState
+/// Regions start with their MemoryArena, their memory follows
+constexpr MemoryIndex RegionArenaOffset = (sizeof(MemoryArena) + 63) & ~(MemoryIndex)63;
+constexpr MemoryIndex RegionAlignment = Kilobytes(4);
+
+/// A MemoryRegion big enough for Contents to be pushed in order
+template <typename Contents>
+struct PlanRegion
 {
-    bool initialized;
-    MemoryArena workingArena;
+    static constexpr MemoryIndex Alignment() { return PlanMax(RegionAlignment, Contents::Alignment()); }
+    static constexpr MemoryIndex Size()
+    {
+        return PlanAlignUp(RegionArenaOffset, Contents::Alignment()) + Contents::Size();
+    }
 };
 
+constexpr MemoryIndex GameStateCapacity = Kilobytes(64);
+constexpr MemoryIndex WorkingStateCapacity = Kilobytes(8);
+constexpr MemoryIndex ScratchArenaSize = Megabytes(1);
+/// With NUMA placement on, each scratch arena gets a huge page to itself
+constexpr MemoryIndex NumaScratchAlignment = Megabytes(2);
+
+/// What the library pushes to the working region
+typedef HeapPlan<PlanArray<ArenaStats>,
+                 PlanBytes<ScratchArenaSize, NumaScratchAlignment, ScratchArenas::MaxThreads>>
+        WorkingRegionPlan;
+
+// NOTE(Chris): The host reserves the heaps from these, so changing them
+// means rebuilding the host too. Each is the heap's root followed by its
+// regions in RegionId order. Anything that moves in the persistent heap
+// is lost from old snapshots, so only add to the end.
+typedef HeapPlan<PlanHeapRoot<GameState, GameStateCapacity>,
+                 /* Region_Permanent */ PlanRegion<PlanBytes<Megabytes(32)>>,
+                 /* Region_Level */ PlanRegion<PlanBytes<Megabytes(32)>>>
+        PersistantHeapPlan;
+typedef HeapPlan<PlanHeapRoot<WorkingState, WorkingStateCapacity>,
+                 /* Region_Frame */ PlanRegion<PlanBytes<Megabytes(16)>>,
+                 /* Region_GpuStaging */ PlanRegion<PlanBytes<Megabytes(16)>>,
+                 /* Region_Working */ PlanRegion<WorkingRegionPlan>>
+        WorkingHeapPlan;
+
+/// Whole huge pages, so the working heap starts on one after the persistent
+constexpr MemoryIndex PersistantHeapSize = PlanAlignUp(PersistantHeapPlan::Size(), Megabytes(2));
+constexpr MemoryIndex WorkingHeapSize = PlanAlignUp(WorkingHeapPlan::Size(), Megabytes(2));
+
 inline void
 InitializeArena(MemoryArena* arena, MemoryIndex size, void* blockStart)
 {
@@ -69,6 +389,28 @@ InitializeArena(MemoryArena* arena, MemoryIndex size, void* blockStart)
     arena->blockStart = static_cast<u8*>(blockStart);
     arena->fillPoint = 0;
     arena->tempCount = 0;
+    arena->growth = ArenaGrowth::Fixed;
+    arena->minBlockSize = 0;
+    arena->growFrom = nullptr;
+    arena->chain = nullptr;
+    arena->stats = nullptr;
+    arena->guards = nullptr;
+    arena->noGuards = false;
+}
+
+/// An arena that starts in blockStart, and chains on blocks of at least
+/// minBlockSize when it fills up. New blocks are pushed onto growFrom,
+/// or mmap'd if that's nullptr.
+inline void
+InitializeGrowableArena(MemoryArena* arena, MemoryIndex size, void* blockStart,
+                        MemoryIndex minBlockSize, MemoryArena* growFrom = nullptr)
+{
+    InitializeArena(arena, size, blockStart);
+    arena->growth = growFrom ? ArenaGrowth::FromArena : ArenaGrowth::FromMmap;
+    arena->minBlockSize = minBlockSize;
+    arena->growFrom = growFrom;
+    if (growFrom)
+        arena->noGuards = growFrom->noGuards;
 }
 
 inline MemoryIndex
@@ -89,41 +431,260 @@ GetAlignmentOffset(const MemoryArena* arena, MemoryIndex alignment)
 inline MemoryIndex
 GetRemainingArenaSize(const MemoryArena* arena, MemoryIndex alignment = 4)
 {
-    return arena->size - (arena->fillPoint + GetAlignmentOffset(arena, alignment));
+    MemoryIndex used = arena->fillPoint + GetAlignmentOffset(arena, alignment);
+    return used < arena->size ? arena->size - used : 0;
+}
+
+/// Bytes in use across every block of the arena
+inline MemoryIndex
+GetArenaBytesUsed(const MemoryArena* arena)
+{
+    MemoryIndex used = arena->fillPoint;
+    for (const ArenaBlockHeader* header = arena->chain; header; header = header->prev)
+        used += header->fillPoint;
+    return used;
+}
+
+/// Unprotect the guard pages of pushes the arena has been rewound past
+inline void
+ReleaseArenaGuards(MemoryArena* arena)
+{
+#if defined(ARENA_GUARDS)
+    MemoryIndex used = GetArenaBytesUsed(arena);
+    LocalPersist const MemoryIndex pageSize = (MemoryIndex)sysconf(_SC_PAGESIZE);
+    while (arena->guards && arena->guards->usedBefore >= used)
+    {
+        mprotect(arena->guards->page, pageSize, PROT_READ | PROT_WRITE);
+        arena->guards = arena->guards->prev;
+    }
+#else
+    (void)arena;
+#endif
+}
+
+inline void* PushBlock(MemoryArena* arena, MemoryIndex size, MemoryIndex alignment = 4
+                       ARENA_SITE_PARAM);
+
+/// Make a new block current, big enough for a push of size/alignment
+inline bool
+GrowArena(MemoryArena* arena, MemoryIndex size, MemoryIndex alignment)
+{
+    MemoryIndex headerSize = sizeof(ArenaBlockHeader);
+    MemoryIndex blockSize = headerSize + size + alignment;
+    if (blockSize < arena->minBlockSize)
+        blockSize = arena->minBlockSize;
+
+    u8* block = nullptr;
+    MemoryIndex growFromFillPoint = 0;
+    if (arena->growth == ArenaGrowth::FromArena)
+    {
+        growFromFillPoint = arena->growFrom->fillPoint;
+        if (GetRemainingArenaSize(arena->growFrom, 64) < blockSize
+            && arena->growFrom->growth == ArenaGrowth::Fixed)
+            return false;
+        block = static_cast<u8*>(PushBlock(arena->growFrom, blockSize, 64));
+    }
+    else if (arena->growth == ArenaGrowth::FromMmap)
+    {
+        void* mem = mmap(nullptr, blockSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        block = mem == MAP_FAILED ? nullptr : static_cast<u8*>(mem);
+    }
+    if (!block)
+        return false;
+
+    ArenaBlockHeader* header = reinterpret_cast<ArenaBlockHeader*>(block);
+    header->blockStart = arena->blockStart;
+    header->size = arena->size;
+    header->fillPoint = arena->fillPoint;
+    header->prev = arena->chain;
+    header->growFromFillPoint = growFromFillPoint;
+
+    arena->chain = header;
+    arena->blockStart = block;
+    arena->size = blockSize;
+    arena->fillPoint = headerSize;
+    return true;
+}
+
+/// Free the current block and go back to the one before it
+inline void
+PopArenaBlock(MemoryArena* arena)
+{
+    ArenaBlockHeader* header = arena->chain;
+    assert(header);
+    u8* block = arena->blockStart;
+    MemoryIndex blockSize = arena->size;
+    MemoryIndex growFromFillPoint = header->growFromFillPoint;
+
+    arena->blockStart = header->blockStart;
+    arena->size = header->size;
+    arena->fillPoint = header->fillPoint;
+    arena->chain = header->prev;
+    ReleaseArenaGuards(arena);
+
+    if (arena->growth == ArenaGrowth::FromMmap)
+    {
+        munmap(block, blockSize);
+    }
+    else if (arena->growth == ArenaGrowth::FromArena)
+    {
+        // NOTE(Chris): Can only be handed back if nothing was pushed to
+        // growFrom after it, otherwise it's reclaimed with growFrom
+        MemoryArena* from = arena->growFrom;
+        if (from->blockStart + from->fillPoint == block + blockSize)
+            from->fillPoint = growFromFillPoint;
+    }
+}
+
+/// Record pushes to arena in stats (which must outlive it). Does
+/// nothing unless built with ARENA_INSTRUMENTATION.
+inline void
+AttachArenaStats(MemoryArena* arena, ArenaStats* stats)
+{
+    arena->stats = stats;
 }
 
 inline void*
-PushBlock(MemoryArena* arena, MemoryIndex size, MemoryIndex alignment = 4)
+PushBlockUnguarded(MemoryArena* arena, MemoryIndex size, MemoryIndex alignment ARENA_SITE_DECL)
 {
     MemoryIndex offset = GetAlignmentOffset(arena, alignment);
+    if (arena->fillPoint + size + offset > arena->size
+        && arena->growth != ArenaGrowth::Fixed
+        && GrowArena(arena, size, alignment))
+    {
+        offset = GetAlignmentOffset(arena, alignment);
+    }
     size += offset;
 
     assert((arena->fillPoint + size) <= arena->size);
     void* blockStart = (arena->blockStart + arena->fillPoint + offset);
     arena->fillPoint += size;
 
+#if defined(ARENA_INSTRUMENTATION)
+    if (arena->stats)
+        RecordArenaPush(arena->stats, size - offset, offset, GetArenaBytesUsed(arena),
+                        ArenaCallSite{siteFile, siteLine});
+#endif
     return blockStart;
 }
 
+/// Push a block that ends against a PROT_NONE page, so writing past its
+/// end faults on the spot instead of corrupting the next push. Costs at
+/// least two pages of arena per call, debug builds only. Arenas marked
+/// noGuards (the host marks the persistent heap's, as it reads them to
+/// snapshot them) get a plain push instead.
+inline void*
+PushGuardedBlock(MemoryArena* arena, MemoryIndex size, MemoryIndex alignment ARENA_SITE_DECL)
+{
+#if defined(ARENA_GUARDS)
+    if (arena->noGuards)
+        return PushBlockUnguarded(arena, size, alignment ARENA_SITE_ARG);
+
+    LocalPersist const MemoryIndex pageSize = (MemoryIndex)sysconf(_SC_PAGESIZE);
+    if (alignment < 16)
+        alignment = 16;
+    // NOTE(Chris): Only overruns past the aligned end are caught,
+    // padding before the end of the block isn't. Aligned past a page
+    // (NUMA scratch), the block starts its body and that's the page
+    // aligned end instead
+    MemoryIndex unit = pageSize;
+    MemoryIndex rounded = (size + alignment - 1) & ~(alignment - 1);
+    if (alignment > pageSize)
+    {
+        unit = alignment;
+        rounded = (size + pageSize - 1) & ~(pageSize - 1);
+    }
+    MemoryIndex body = (rounded + pageSize - 1) & ~(pageSize - 1);
+
+    MemoryIndex usedBefore = GetArenaBytesUsed(arena);
+    ArenaGuard* guard = static_cast<ArenaGuard*>(PushBlockUnguarded(arena, sizeof(ArenaGuard),
+                                                                    alignof(ArenaGuard)
+                                                                    ARENA_SITE_ARG));
+    u8* raw = static_cast<u8*>(PushBlockUnguarded(arena, body + pageSize, unit ARENA_SITE_ARG));
+    u8* page = raw + body;
+
+    guard->prev = arena->guards;
+    guard->page = page;
+    guard->usedBefore = usedBefore;
+    if (mprotect(page, pageSize, PROT_NONE) == 0)
+        arena->guards = guard;
+    return page - rounded;
+#else
+    return PushBlockUnguarded(arena, size, alignment ARENA_SITE_ARG);
+#endif
+}
+
+inline void*
+PushBlock(MemoryArena* arena, MemoryIndex size, MemoryIndex alignment ARENA_SITE_DECL)
+{
+#if defined(ARENA_GUARDS) && defined(ARENA_GUARD_PUSHES)
+    return PushGuardedBlock(arena, size, alignment ARENA_SITE_ARG);
+#else
+    return PushBlockUnguarded(arena, size, alignment ARENA_SITE_ARG);
+#endif
+}
+
 template <typename T>
 inline T*
-PushArray(MemoryArena* arena, size_t num, MemoryIndex alignment = 4)
+PushArray(MemoryArena* arena, size_t num, MemoryIndex alignment = 4 ARENA_SITE_PARAM)
 {
-    return static_cast<T*>(PushBlock(arena, num*sizeof(T), alignment));
+    return static_cast<T*>(PushBlock(arena, num*sizeof(T), alignment ARENA_SITE_ARG));
 }
 
 template <typename T>
 inline T*
-PushStruct(MemoryArena* arena, MemoryIndex alignment = 4)
+PushStruct(MemoryArena* arena, MemoryIndex alignment = 4 ARENA_SITE_PARAM)
 {
-    return static_cast<T*>(PushBlock(arena, sizeof(T), alignment));
+    return static_cast<T*>(PushBlock(arena, sizeof(T), alignment ARENA_SITE_ARG));
+}
+
+/// PushBlock for an arena shared between threads: any number of threads
+/// may push at once, each push a compare-exchange on fillPoint that
+/// only goes through if the block fits. Returns nullptr if it doesn't,
+/// leaving the arena as it was. Don't mix with the plain Push*, or with
+/// TempBlocks, while other threads are pushing.
+/// The arena must be Fixed and have no stats attached: growing, stats
+/// and guard pages (ARENA_GUARD_PUSHES) aren't thread safe, and are
+/// only on the plain Push* path.
+inline void*
+PushBlockAtomic(MemoryArena* arena, MemoryIndex size, MemoryIndex alignment = 4)
+{
+    assert(arena->growth == ArenaGrowth::Fixed && !arena->stats);
+
+    MemoryIndex fillPoint = __atomic_load_n(&arena->fillPoint, __ATOMIC_RELAXED);
+    MemoryIndex start;
+    do
+    {
+        MemoryIndex address = (MemoryIndex)arena->blockStart + fillPoint;
+        start = fillPoint + (((address + alignment - 1) & ~(alignment - 1)) - address);
+        if (start + size > arena->size)
+            return nullptr;
+    } while (!__atomic_compare_exchange_n(&arena->fillPoint, &fillPoint, start + size, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    return arena->blockStart + start;
+}
+
+template <typename T>
+inline T*
+PushArrayAtomic(MemoryArena* arena, size_t num, MemoryIndex alignment = 4)
+{
+    return static_cast<T*>(PushBlockAtomic(arena, num*sizeof(T), alignment));
+}
+
+template <typename T>
+inline T*
+PushStructAtomic(MemoryArena* arena, MemoryIndex alignment = 4)
+{
+    return static_cast<T*>(PushBlockAtomic(arena, sizeof(T), alignment));
 }
 
 inline char*
-PushString(MemoryArena* arena, const char* src)
+PushString(MemoryArena* arena, const char* src ARENA_SITE_PARAM)
 {
     size_t size = strlen(src);
-    char* dest = static_cast<char*>(PushBlock(arena, size));
+    char* dest = static_cast<char*>(PushBlock(arena, size, 4 ARENA_SITE_ARG));
     strcpy(dest, src);
     return dest;
 }
@@ -133,8 +694,9 @@ CreateTempBlock(MemoryArena* arena)
 {
     TempBlock mem;
     mem.arena = arena;
+    mem.blockStart = arena->blockStart;
     mem.fillPoint = arena->fillPoint;
-    ++(arena->tempCount);
+    mem.depth = ++(arena->tempCount);
 
     return mem;
 }
@@ -143,8 +705,14 @@ inline void
 ClearTempBlock(TempBlock block)
 {
     MemoryArena* arena = block.arena;
+    // NOTE(Chris): Clearing an outer block first would rewind past the
+    // inner one, which its owner still thinks is live
+    assert(arena->tempCount == block.depth);
+    while (arena->blockStart != block.blockStart)
+        PopArenaBlock(arena);
     assert(arena->fillPoint >= block.fillPoint);
     arena->fillPoint = block.fillPoint;
+    ReleaseArenaGuards(arena);
     assert(arena->tempCount > 0);
     --(arena->tempCount);
 }
@@ -155,31 +723,296 @@ CheckArenaNoTemps(MemoryArena* arena)
     assert(arena->tempCount == 0);
 }
 
+/// A TempBlock cleared when it goes out of scope, e.g. for per-iteration
+/// scratch in a loop:
+///   for (...)
+///   {
+///       ScopedTempBlock temp(arena);
+///       Foo* foo = PushStruct<Foo>(arena);
+///   }
+struct ScopedTempBlock
+{
+    TempBlock block;
+
+    explicit ScopedTempBlock(MemoryArena* arena)
+        : block(CreateTempBlock(arena))
+    {}
+
+    ~ScopedTempBlock()
+    {
+        ClearTempBlock(block);
+    }
+
+    ScopedTempBlock(const ScopedTempBlock&) = delete;
+    ScopedTempBlock& operator=(const ScopedTempBlock&) = delete;
+};
+
+/// Free every chained block, leaving the arena empty in its first block
+inline void
+ResetArena(MemoryArena* arena)
+{
+    CheckArenaNoTemps(arena);
+    while (arena->chain)
+        PopArenaBlock(arena);
+    arena->fillPoint = 0;
+    ReleaseArenaGuards(arena);
+}
+
+inline MemoryArena*
+GetRegionArena(CompleteState* state, RegionId region)
+{
+    return state->regions[region].arena;
+}
+
+/// Free everything in every region with this lifetime
 inline void
-CreateSubArena(MemoryArena* sub, MemoryArena* arena, MemoryIndex size, MemoryIndex alignment = 16)
+ResetRegions(CompleteState* state, RegionLifetime lifetime)
 {
-    sub->size = size;
-    sub->blockStart = (u8*)PushBlock(arena, size, alignment);
-    sub->fillPoint = 0;
-    sub->tempCount = 0;
+    if (lifetime == RegionLifetime::Working)
+        return;
+
+    for (u32 i = 0; i < Region_Count; ++i)
+    {
+        if (state->regions[i].lifetime == lifetime && state->regions[i].arena)
+            ResetArena(state->regions[i].arena);
+    }
+}
+
+inline void
+ResetRegion(CompleteState* state, RegionId region)
+{
+    ResetArena(state->regions[region].arena);
+}
+
+inline void
+CreateSubArena(MemoryArena* sub, MemoryArena* arena, MemoryIndex size, MemoryIndex alignment = 16
+               ARENA_SITE_PARAM)
+{
+#if defined(ARENA_GUARDS)
+    InitializeArena(sub, size, PushGuardedBlock(arena, size, alignment ARENA_SITE_ARG));
+#else
+    InitializeArena(sub, size, PushBlock(arena, size, alignment ARENA_SITE_ARG));
+#endif
+    sub->noGuards = arena->noGuards;
+}
+
+/// Epochs come from a counter in the library rather than the heap, so
+/// they can't repeat when a snapshot rewinds the heap. The counter and
+/// GetScratchArena's thread_local claims are both function statics, so
+/// they have the same linkage: each loaded copy of Loop has its own
+/// (it's built with -fno-gnu-unique), or with GNU_UNIQUE symbols every
+/// copy shares both. Either way a claim can't match an epoch it wasn't
+/// handed out under. A fresh counter comes with no claims, and a shared
+/// one never repeats.
+inline u64
+NextScratchEpoch()
+{
+    LocalPersist std::atomic<u64> counter(0);
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+/// Hand every scratch arena back, for a new set of threads. Call when
+/// the library is reloaded, as the threads' claims are lost with it.
+inline void
+ReleaseScratchClaims(ScratchArenas* scratch)
+{
+    scratch->numClaimed.store(0, std::memory_order_relaxed);
+    scratch->epoch.store(NextScratchEpoch(), std::memory_order_release);
+}
+
+/// Carve the per-thread arenas out of arena. Only the pages a thread
+/// actually touches are ever faulted in, so perThreadSize can be generous.
+/// Aligning to the (huge) page size stops arenas sharing pages, so each
+/// is placed on the NUMA node of the thread that first touches it.
+inline void
+InitScratchArenas(ScratchArenas* scratch, MemoryArena* arena, MemoryIndex perThreadSize,
+                  MemoryIndex alignment = 64)
+{
+    scratch->perThreadSize = perThreadSize;
+    for (u32 i = 0; i < ScratchArenas::MaxThreads; ++i)
+        CreateSubArena(&scratch->arenas[i], arena, perThreadSize, alignment);
+    ReleaseScratchClaims(scratch);
+}
+
+/// The calling thread's scratch arena, or nullptr if more than
+/// MaxThreads threads have asked. Only the claim is atomic.
+inline MemoryArena*
+GetScratchArena(ScratchArenas* scratch)
+{
+    struct ScratchClaim
+    {
+        const ScratchArenas* owner;
+        u64 epoch;
+        MemoryArena* arena;
+    };
+    LocalPersist thread_local ScratchClaim claim;
+
+    u64 epoch = scratch->epoch.load(std::memory_order_acquire);
+    if (claim.owner == scratch && claim.epoch == epoch)
+        return claim.arena;
+
+    u32 index = scratch->numClaimed.fetch_add(1, std::memory_order_relaxed);
+    if (index >= ScratchArenas::MaxThreads)
+        return nullptr;
+
+    claim.owner = scratch;
+    claim.epoch = epoch;
+    claim.arena = &scratch->arenas[index];
+    return claim.arena;
+}
+
+/// Empty every scratch arena, threads keep their claims. Call once per
+/// frame, with no other thread still using its scratch memory.
+inline void
+ResetScratchArenas(ScratchArenas* scratch)
+{
+    u32 claimed = scratch->numClaimed.load(std::memory_order_relaxed);
+    if (claimed > ScratchArenas::MaxThreads)
+        claimed = ScratchArenas::MaxThreads;
+
+    for (u32 i = 0; i < claimed; ++i)
+    {
+        ResetArena(&scratch->arenas[i]);
+    }
+}
+
+template <u32 N>
+inline void
+InitFrameArenas(FrameArenas<N>* frames, MemoryArena* arena, MemoryIndex perFrameSize)
+{
+    for (u32 i = 0; i < N; ++i)
+        CreateSubArena(&frames->arenas[i], arena, perFrameSize, 64);
+    frames->writeFrame = 0;
+    frames->reading.store(0, std::memory_order_relaxed);
+    frames->published.store(0, std::memory_order_release);
+}
+
+/// Where the producer pushes this frame's data
+template <u32 N>
+inline MemoryArena*
+GetWriteArena(FrameArenas<N>* frames)
+{
+    return &frames->arenas[frames->writeFrame % N];
+}
+
+/// Producer only, at the frame boundary. Publishes the frame just
+/// written and moves on to the next, resetting its arena. Waits if the
+/// consumer is still reading the frame that arena held N frames ago.
+template <u32 N>
+inline void
+FlipFrameArenas(FrameArenas<N>* frames)
+{
+    u64 next = frames->writeFrame + 1;
+    // NOTE(Chris): seq_cst on published and reading (here and in
+    // AcquireReadArena) so that either we see the consumer's claim or it
+    // sees this frame was published and claims a newer one
+    frames->published.store(next);
+    u64 reading;
+    while ((reading = frames->reading.load()) != 0 && (reading - 1) % N == next % N)
+        std::this_thread::yield();
+
+    frames->writeFrame = next;
+    ResetArena(&frames->arenas[next % N]);
+}
+
+/// Consumer only. The arena of the latest complete frame, or nullptr if
+/// none has been published yet. The data has to be found from the
+/// arena's start, so the first push of a frame is a good place for a
+/// header. Stays valid until ReleaseReadArena.
+template <u32 N>
+inline const MemoryArena*
+AcquireReadArena(FrameArenas<N>* frames, u64* frame = nullptr)
+{
+    u64 published = frames->published.load();
+    while (published != 0)
+    {
+        frames->reading.store(published);
+        u64 check = frames->published.load();
+        if (check == published)
+        {
+            if (frame)
+                *frame = published - 1;
+            return &frames->arenas[(published - 1) % N];
+        }
+        published = check;
+    }
+    return nullptr;
+}
+
+template <u32 N>
+inline void
+ReleaseReadArena(FrameArenas<N>* frames)
+{
+    frames->reading.store(0, std::memory_order_release);
+}
+
+/// Zero a block with streaming stores, bypassing the cache. Opt in for
+/// big clears of memory that won't be read again soon, so they don't
+/// evict everything else. It isn't faster: ZeroBench has memset ahead
+/// (16.4 against 13.8 GiB/s at 64 MiB), so ZeroBlock doesn't use it.
+inline void
+ZeroBlockStreaming(void* block, MemoryIndex size)
+{
+#if defined(__SSE2__)
+    u8* bytes = static_cast<u8*>(block);
+    MemoryIndex head = (16 - ((MemoryIndex)bytes & 15)) & 15;
+    if (head > size)
+        head = size;
+    memset(bytes, 0, head);
+    bytes += head;
+    size -= head;
+
+    __m128i zero = _mm_setzero_si128();
+    for (; size >= 64; size -= 64, bytes += 64)
+    {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(bytes), zero);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(bytes + 16), zero);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(bytes + 32), zero);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(bytes + 48), zero);
+    }
+    // NOTE(Chris): Streaming stores are weakly ordered, make them
+    // visible before anything that follows
+    _mm_sfence();
+    memset(bytes, 0, size);
+#else
+    memset(block, 0, size);
+#endif
 }
 
 inline void
 ZeroBlock(void* block, MemoryIndex size)
 {
-    u8* byte = static_cast<u8*>(block);
-    // C stdlib may provide a better way of doing this
-    while (size--)
+    // NOTE(Chris): memset already picks rep stosb or SIMD stores for the CPU
+    memset(block, 0, size);
+}
+
+/// Zero a block by handing its pages back to the OS, they read as zero
+/// (and cost nothing) until touched again. Only for anonymous private
+/// memory: the pages of a restored snapshot would revert to the file,
+/// so never use it on the persistent heap.
+inline void
+DiscardBlock(void* block, MemoryIndex size)
+{
+    LocalPersist const MemoryIndex pageSize = (MemoryIndex)sysconf(_SC_PAGESIZE);
+    MemoryIndex start = (MemoryIndex)block;
+    MemoryIndex pagesStart = (start + pageSize - 1) & ~(pageSize - 1);
+    MemoryIndex pagesEnd = (start + size) & ~(pageSize - 1);
+
+    if (pagesEnd <= pagesStart
+        || madvise(reinterpret_cast<void*>(pagesStart), pagesEnd - pagesStart, MADV_DONTNEED) != 0)
     {
-        *(byte++) = 0;
+        ZeroBlock(block, size);
+        return;
     }
+    ZeroBlock(block, pagesStart - start);
+    ZeroBlock(reinterpret_cast<void*>(pagesEnd), start + size - pagesEnd);
 }
 
 template <typename T>
 inline void
 ZeroStruct(T* obj)
 {
-    ZeroBlock(static_cast<void*>(obj), sizeof(obj));
+    ZeroBlock(static_cast<void*>(obj), sizeof(T));
 }
 
 template <typename T>
@@ -189,6 +1022,28 @@ ZeroArray(T* obj, size_t num)
     ZeroBlock(static_cast<void*>(obj), num * sizeof(obj[0]));
 }
 
+/// Clears at least this big are worth a madvise to discard the pages
+constexpr MemoryIndex DiscardZeroSize = Megabytes(1);
+
+/// ResetArena, and zero everything that had been pushed so the arena
+/// starts again from clean memory. With discard (anonymous memory only,
+/// see DiscardBlock) large clears just drop the pages.
+inline void
+ClearArena(MemoryArena* arena, bool discard = false)
+{
+    // NOTE(Chris): Chained blocks are freed outright, only the first
+    // block's used bytes need zeroing
+    MemoryIndex used = arena->fillPoint;
+    for (ArenaBlockHeader* header = arena->chain; header; header = header->prev)
+        used = header->fillPoint;
+    ResetArena(arena);
+
+    if (discard && used >= DiscardZeroSize)
+        DiscardBlock(arena->blockStart, used);
+    else
+        ZeroBlock(arena->blockStart, used);
+}
+
 inline void
 CopyBlock(void* dest, const void* src, size_t numBytes)
 {
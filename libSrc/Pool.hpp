@@ -0,0 +1,163 @@
+// -*- c++ -*-
+#if !defined(POOL_H)
+/* ==========================================================================
+   $File: Pool.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Fixed-size object pool on top of a MemoryArena, for things that come
+   and go individually (entities, particles...). Slots are carved from
+   the arena a cache-line-aligned slab at a time and recycled through a
+   free list threaded through the free slots themselves, so alloc and
+   free are O(1) and never touch the arena after the first slab.
+
+   Objects are referred to by PoolHandle rather than pointer. A handle
+   carries the generation of its slot, which changes every time the slot
+   is freed, so a handle to a freed (or reused) slot is detected rather
+   than silently aliasing the new occupant. Handles are plain indices,
+   so unlike pointers they're still valid in a restored snapshot.
+   ========================================================================== */
+
+#define POOL_H
+#include "../src/LethaniGlobalDefines.h"
+#include "MemoryLayout.hpp"
+#include <new>
+
+/// generation 0 is never live, so a zeroed handle is null
+struct PoolHandle
+{
+    u32 index;
+    u32 generation;
+};
+
+inline bool
+IsNullHandle(PoolHandle handle)
+{
+    return handle.generation == 0;
+}
+
+constexpr MemoryIndex CacheLineSize = 64;
+
+template <typename T, u32 SlotsPerSlab = 256>
+struct Pool
+{
+    struct Slot
+    {
+        /// Holds the T while live, and the next free index + 1 while free
+        alignas(T) alignas(u32) u8 storage[sizeof(T) > sizeof(u32) ? sizeof(T) : sizeof(u32)];
+        /// Odd while live, even while free
+        u32 generation;
+    };
+
+    MemoryArena* arena;
+    /// Table of slab pointers, maxSlabs long
+    Slot** slabs;
+    u32 maxSlabs;
+    u32 numSlabs;
+    /// Slots handed out at least once, beyond this they're untouched
+    u32 numUsed;
+    /// Index + 1 of the first free slot, 0 if empty
+    u32 freeHead;
+    u32 numLive;
+};
+
+/// Room is reserved for maxObjects rounded up to a whole number of
+/// slabs, and the pool will hand out that many: with the default 256
+/// slots per slab, InitPool(&pool, arena, 1000) holds 1024 objects.
+template <typename T, u32 SlotsPerSlab>
+inline void
+InitPool(Pool<T, SlotsPerSlab>* pool, MemoryArena* arena, u32 maxObjects)
+{
+    typedef typename Pool<T, SlotsPerSlab>::Slot Slot;
+    pool->arena = arena;
+    pool->maxSlabs = (maxObjects + SlotsPerSlab - 1) / SlotsPerSlab;
+    pool->slabs = PushArray<Slot*>(arena, pool->maxSlabs, alignof(Slot*));
+    pool->numSlabs = 0;
+    pool->numUsed = 0;
+    pool->freeHead = 0;
+    pool->numLive = 0;
+}
+
+template <typename T, u32 SlotsPerSlab>
+inline typename Pool<T, SlotsPerSlab>::Slot*
+GetPoolSlot(Pool<T, SlotsPerSlab>* pool, u32 index)
+{
+    return &pool->slabs[index / SlotsPerSlab][index % SlotsPerSlab];
+}
+
+/// Construct a T in a free slot. Returns a null handle if the pool is
+/// full, out may be null.
+template <typename T, u32 SlotsPerSlab>
+inline PoolHandle
+PoolAlloc(Pool<T, SlotsPerSlab>* pool, T** out = nullptr)
+{
+    typedef typename Pool<T, SlotsPerSlab>::Slot Slot;
+    u32 index;
+    if (pool->freeHead)
+    {
+        index = pool->freeHead - 1;
+        Slot* slot = GetPoolSlot(pool, index);
+        pool->freeHead = *reinterpret_cast<u32*>(slot->storage);
+    }
+    else
+    {
+        if (pool->numUsed == pool->numSlabs * SlotsPerSlab)
+        {
+            if (pool->numSlabs == pool->maxSlabs)
+                return PoolHandle{0, 0};
+
+            pool->slabs[pool->numSlabs] = PushArray<Slot>(pool->arena, SlotsPerSlab,
+                                                          CacheLineSize);
+            // NOTE(Chris): Generations start at 0 (free) whatever the
+            // arena had in it before
+            for (u32 i = 0; i < SlotsPerSlab; ++i)
+                pool->slabs[pool->numSlabs][i].generation = 0;
+            ++pool->numSlabs;
+        }
+        index = pool->numUsed++;
+    }
+
+    Slot* slot = GetPoolSlot(pool, index);
+    ++slot->generation;
+    ++pool->numLive;
+    T* obj = new (slot->storage) T();
+    if (out)
+        *out = obj;
+    return PoolHandle{index, slot->generation};
+}
+
+/// The object handle refers to, or nullptr if it's been freed
+template <typename T, u32 SlotsPerSlab>
+inline T*
+PoolGet(Pool<T, SlotsPerSlab>* pool, PoolHandle handle)
+{
+    if (IsNullHandle(handle) || handle.index >= pool->numUsed)
+        return nullptr;
+
+    auto* slot = GetPoolSlot(pool, handle.index);
+    if (slot->generation != handle.generation)
+        return nullptr;
+    return reinterpret_cast<T*>(slot->storage);
+}
+
+/// Destroy the object, returns false if handle was already stale
+template <typename T, u32 SlotsPerSlab>
+inline bool
+PoolFree(Pool<T, SlotsPerSlab>* pool, PoolHandle handle)
+{
+    T* obj = PoolGet(pool, handle);
+    if (!obj)
+        return false;
+
+    obj->~T();
+    auto* slot = GetPoolSlot(pool, handle.index);
+    ++slot->generation;
+    *reinterpret_cast<u32*>(slot->storage) = pool->freeHead;
+    pool->freeHead = handle.index + 1;
+    --pool->numLive;
+    return true;
+}
+
+#endif
@@ -0,0 +1,128 @@
+// -*- c++ -*-
+#if !defined(STATELAYOUT_H)
+/* ==========================================================================
+   $File: StateLayout.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Layout descriptions ("metastructs") for structs that live in the
+   heaps and so have to survive a reload of the code that defines them.
+
+   Declare such a struct with a field list macro:
+
+     #define FOO_FIELDS(Field) \
+         Field(bool, initialized) \
+         Field(f32, time)
+     HEAP_STRUCT(Foo, FOO_FIELDS);
+
+   This defines struct Foo as normal, plus LayoutOf<Foo> holding a
+   compile-time signature of the layout (field names, types, offsets
+   and sizes) and a table of the fields. The heap keeps a copy of the
+   layout each struct was written with, so when a reload brings in a
+   different layout the host can move the data across field by field,
+   matching on name. Fields that are new, or have changed type or size,
+   are zeroed.
+
+   Types are compared by spelling and size only: a change inside a
+   nested struct that keeps its size won't be noticed. Types containing
+   commas (templates) need a typedef to go through the field macro.
+   ========================================================================== */
+
+#define STATELAYOUT_H
+#include "../src/LethaniGlobalDefines.h"
+#include <cstddef>
+
+/// FNV-1a, usable at compile time
+constexpr u64 LayoutHash(const char* str, u64 hash = 0xCBF29CE484222325ULL)
+{
+    return *str ? LayoutHash(str + 1, (hash ^ (u64)(u8)*str) * 0x100000001B3ULL) : hash;
+}
+
+constexpr u64 FieldSignature(u64 nameHash, u64 typeHash, std::size_t offset, std::size_t size)
+{
+    return HashMix(nameHash ^ HashMix(typeHash + offset * 0x9E3779B97F4A7C15ULL + size));
+}
+
+struct FieldLayout
+{
+    const char* name;
+    u32 offset;
+    u32 size;
+    u64 typeHash;
+};
+
+struct StructLayout
+{
+    const char* name;
+    u32 size;
+    u32 numFields;
+    u64 signature;
+    const FieldLayout* fields;
+};
+
+/// Specialised by HEAP_STRUCT
+template <typename T>
+struct LayoutOf;
+
+/// Limits for the copy of a layout stored in the heap
+constexpr u32 MaxLayoutFields = 32;
+constexpr u32 MaxLayoutName = 32;
+
+#define HEAP_STRUCT_FIELD(type, name) type name;
+#define HEAP_STRUCT_FIELD_COUNT(type, name) + 1
+#define HEAP_STRUCT_FIELD_SIGNATURE(type, name)                         \
+    ^ FieldSignature(LayoutHash(#name), LayoutHash(#type), offsetof(Self, name), sizeof(type))
+#define HEAP_STRUCT_FIELD_LAYOUT(type, name)                            \
+    {#name, (u32)offsetof(Self, name), (u32)sizeof(type), LayoutHash(#type)},
+#define HEAP_STRUCT_FIELD_CHECK(type, name)                             \
+    static_assert(sizeof(#name) <= MaxLayoutName, "Heap struct field name too long");
+
+#define HEAP_STRUCT(Name, FIELDS)                                       \
+    struct Name                                                         \
+    {                                                                   \
+        FIELDS(HEAP_STRUCT_FIELD)                                       \
+    };                                                                  \
+    template <>                                                         \
+    struct LayoutOf<Name>                                               \
+    {                                                                   \
+        typedef Name Self;                                              \
+        FIELDS(HEAP_STRUCT_FIELD_CHECK)                                 \
+        /* Enums rather than static members so they're never odr-used */ \
+        enum : u32 { NumFields = 0 FIELDS(HEAP_STRUCT_FIELD_COUNT) };   \
+        static_assert(NumFields <= MaxLayoutFields, "Too many fields in heap struct"); \
+        enum : u64                                                      \
+        {                                                               \
+            Signature =                                                 \
+                HashMix(LayoutHash(#Name) ^ sizeof(Name) FIELDS(HEAP_STRUCT_FIELD_SIGNATURE)) \
+        };                                                              \
+        static const StructLayout& Get()                                \
+        {                                                               \
+            static const FieldLayout fields[] = { FIELDS(HEAP_STRUCT_FIELD_LAYOUT) }; \
+            static const StructLayout layout = {#Name, (u32)sizeof(Name), NumFields, Signature, fields}; \
+            return layout;                                              \
+        }                                                               \
+    }
+
+/// Copy of a FieldLayout kept in the heap, so it outlives the library
+struct PersistedField
+{
+    char name[MaxLayoutName];
+    u32 offset;
+    u32 size;
+    u64 typeHash;
+};
+
+/// Precedes each heap root, describing the layout its data was written with
+struct HeapRootHeader
+{
+    /// 0 if the root has never been written
+    u64 signature;
+    u32 size;
+    u32 numFields;
+    char name[MaxLayoutName];
+    PersistedField fields[MaxLayoutFields];
+};
+
+#endif
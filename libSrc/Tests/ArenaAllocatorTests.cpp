@@ -0,0 +1,88 @@
+/* ==========================================================================
+   $File: ArenaAllocatorTests.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "../ArenaAllocator.hpp"
+#include "../Jasnah.hpp"
+#define CATCH_CONFIG_MAIN
+#include "../../Tests/catch.hpp"
+#include <vector>
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+FileScope bool InArena(const MemoryArena* arena, const void* ptr)
+{
+    const u8* p = static_cast<const u8*>(ptr);
+    return p >= arena->blockStart && p < arena->blockStart + arena->size;
+}
+
+TEST_CASE("std::vector can allocate from an arena", "[ArenaAllocator]")
+{
+    std::vector<u8> heap(Kilobytes(64));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    ArenaVector<u64> v{ArenaAllocator<u64>(&arena)};
+    for (u64 i = 0; i < 100; ++i)
+        v.push_back(i);
+    REQUIRE(InArena(&arena, v.data()));
+    REQUIRE(((MemoryIndex)v.data() % alignof(u64)) == 0);
+    REQUIRE(v[99] == 99);
+
+    TempBlock temp = CreateTempBlock(&arena);
+    MemoryIndex fill = arena.fillPoint;
+    {
+        ArenaVector<u32> scoped{ArenaAllocator<u32>(temp)};
+        scoped.resize(1000);
+        REQUIRE(arena.fillPoint > fill);
+    }
+    ClearTempBlock(temp);
+    REQUIRE(arena.fillPoint == fill);
+}
+
+TEST_CASE("Jasnah Map and Filter keep the arena allocator", "[ArenaAllocator]")
+{
+    std::vector<u8> heap(Kilobytes(64));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    ArenaVector<int> v{ArenaAllocator<int>(&arena)};
+    for (int i = 0; i < 10; ++i)
+        v.push_back(i);
+
+    auto evens = Jasnah::FilterContainer(v, [](int x) { return x % 2 == 0; });
+    REQUIRE(evens.size() == 5);
+    REQUIRE(InArena(&arena, evens.data()));
+
+    auto halves = Jasnah::MapToContainer(v, [](int x) { return x * 0.5; });
+    static_assert(std::is_same<decltype(halves), ArenaVector<double>>::value,
+                  "Map should rebind the allocator");
+    REQUIRE(halves[3] == 1.5);
+    REQUIRE(InArena(&arena, halves.data()));
+
+    std::vector<int> plain{1, 2, 3};
+    auto doubled = Jasnah::MapToContainer(plain, [](int x) { return 2 * x; });
+    static_assert(std::is_same<decltype(doubled), std::vector<int>>::value,
+                  "Default allocator should be unchanged");
+    REQUIRE(doubled[2] == 6);
+}
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+TEST_CASE("pmr containers can allocate from an arena", "[ArenaAllocator]")
+{
+    std::vector<u8> heap(Kilobytes(64));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    ArenaResource resource(&arena);
+    std::pmr::vector<double> v(&resource);
+    v.resize(100, 1.0);
+    REQUIRE(InArena(&arena, v.data()));
+}
+#endif
+#endif
@@ -0,0 +1,101 @@
+/* ==========================================================================
+   $File: ArenaBench.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Arena allocation throughput. Not a test, build and run by hand:
+     g++ -std=c++11 -O2 ArenaBench.cpp -lpthread -o ArenaBench
+   ========================================================================== */
+
+#include "../MemoryLayout.hpp"
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// NOTE(Chris): Sized so the heap (about 100 MiB) fits on a small box
+FileScope constexpr u32 PushesPerThread = 1 << 16;
+FileScope constexpr u32 MaxBenchThreads = 16;
+// NOTE(Chris): A spread of small sizes, as for command lists
+FileScope constexpr MemoryIndex PushSizes[] = {16, 24, 48, 64, 8, 32, 96, 40};
+FileScope constexpr u32 NumPushSizes = sizeof(PushSizes) / sizeof(PushSizes[0]);
+
+typedef void (*BenchFn)(MemoryArena* arena, u32 thread, u32 numThreads);
+
+FileScope void BenchSingle(MemoryArena* arena, u32 thread, u32 numThreads)
+{
+    // NOTE(Chris): The unsynchronised path can't be shared, so one
+    // thread does everyone's pushes
+    if (thread != 0)
+        return;
+    for (u32 i = 0; i < PushesPerThread * numThreads; ++i)
+    {
+        u8* block = static_cast<u8*>(PushBlock(arena, PushSizes[i % NumPushSizes], 8));
+        block[0] = (u8)i;
+    }
+}
+
+FileScope void BenchAtomic(MemoryArena* arena, u32, u32)
+{
+    for (u32 i = 0; i < PushesPerThread; ++i)
+    {
+        u8* block = static_cast<u8*>(PushBlockAtomic(arena, PushSizes[i % NumPushSizes], 8));
+        block[0] = (u8)i;
+    }
+}
+
+FileScope void BenchMalloc(MemoryArena*, u32, u32)
+{
+    // NOTE(Chris): Freed in bulk at the end to match the arena's lifetime
+    std::vector<void*> blocks(PushesPerThread);
+    for (u32 i = 0; i < PushesPerThread; ++i)
+    {
+        u8* block = static_cast<u8*>(malloc(PushSizes[i % NumPushSizes]));
+        block[0] = (u8)i;
+        blocks[i] = block;
+    }
+    for (void* block : blocks)
+        free(block);
+}
+
+FileScope f64 RunBench(BenchFn fn, u32 numThreads, std::vector<u8>* heap)
+{
+    MemoryArena arena;
+    InitializeArena(&arena, heap->size(), heap->data());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (u32 i = 1; i < numThreads; ++i)
+        threads.emplace_back(fn, &arena, i, numThreads);
+    fn(&arena, 0, numThreads);
+    for (auto& t : threads)
+        t.join();
+    std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - start;
+
+    // NOTE(Chris): Millions of pushes per second
+    return (f64)PushesPerThread * numThreads / elapsed.count() / 1e6;
+}
+
+int main()
+{
+    MemoryIndex maxPush = 0;
+    for (u32 i = 0; i < NumPushSizes; ++i)
+        maxPush = PushSizes[i] > maxPush ? PushSizes[i] : maxPush;
+
+    std::vector<u8> heap((maxPush + 8) * PushesPerThread * MaxBenchThreads);
+    // NOTE(Chris): Fault everything in up front so we time the allocators
+    ZeroBlock(heap.data(), heap.size());
+
+    printf("%8s %14s %14s %14s\n", "threads", "single Mop/s", "atomic Mop/s", "malloc Mop/s");
+    for (u32 numThreads = 1; numThreads <= MaxBenchThreads; numThreads *= 2)
+    {
+        printf("%8u %14.1f %14.1f %14.1f\n", numThreads,
+               RunBench(BenchSingle, numThreads, &heap),
+               RunBench(BenchAtomic, numThreads, &heap),
+               RunBench(BenchMalloc, numThreads, &heap));
+    }
+    return 0;
+}
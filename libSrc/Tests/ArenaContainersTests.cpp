@@ -0,0 +1,102 @@
+/* ==========================================================================
+   $File: ArenaContainersTests.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "../ArenaContainers.hpp"
+#define CATCH_CONFIG_MAIN
+#include "../../Tests/catch.hpp"
+#include <vector>
+#include <cstring>
+
+TEST_CASE("Arena arrays grow in place when they can", "[ArenaContainers]")
+{
+    std::vector<u8> heap(Kilobytes(64));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    ArenaArray<u32> array;
+    InitArray(&array, &arena, 4);
+    u32* start = array.data;
+    for (u32 i = 0; i < 100; ++i)
+        ArrayPush(&array, i);
+    REQUIRE(array.data == start);
+    REQUIRE(array.count == 100);
+
+    u32 sum = 0;
+    for (u32 v : array)
+        sum += v;
+    REQUIRE(sum == 4950);
+
+    // NOTE(Chris): Something else on top of it now, so it has to move
+    PushStruct<u64>(&arena);
+    for (u32 i = 0; i < 200; ++i)
+        ArrayPush(&array, i);
+    REQUIRE(array.data != start);
+    REQUIRE(array[99] == 99);
+    REQUIRE(array[299] == 199);
+}
+
+TEST_CASE("Arena hash maps insert, find and remove", "[ArenaContainers]")
+{
+    std::vector<u8> heap(Megabytes(1));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    ArenaHashMap<u32, u32> map;
+    InitHashMap(&map, &arena);
+    for (u32 i = 0; i < 1000; ++i)
+        HashMapInsert(&map, i * 7, i);
+    REQUIRE(map.count == 1000);
+
+    for (u32 i = 0; i < 1000; ++i)
+    {
+        u32* value = HashMapFind(&map, i * 7);
+        REQUIRE(value);
+        REQUIRE(*value == i);
+    }
+    REQUIRE(HashMapFind(&map, 1u) == nullptr);
+
+    for (u32 i = 0; i < 1000; i += 2)
+        REQUIRE(HashMapRemove(&map, i * 7));
+    REQUIRE(!HashMapRemove(&map, 0u));
+    REQUIRE(map.count == 500);
+    REQUIRE(HashMapFind(&map, 14u) == nullptr);
+    REQUIRE(*HashMapFind(&map, 21u) == 3);
+
+    HashMapInsert(&map, 21u, 42u);
+    REQUIRE(*HashMapFind(&map, 21u) == 42);
+    REQUIRE(map.count == 500);
+
+    // NOTE(Chris): Churn shouldn't fill the table with tombstones
+    u32 capacity = map.capacity;
+    for (u32 i = 0; i < 10000; ++i)
+    {
+        HashMapInsert(&map, 100000 + i, i);
+        HashMapRemove(&map, 100000 + i);
+    }
+    REQUIRE(map.capacity == capacity);
+    REQUIRE(map.count == 500);
+}
+
+TEST_CASE("String builders append and format", "[ArenaContainers]")
+{
+    std::vector<u8> heap(Kilobytes(64));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    StringBuilder str;
+    InitStringBuilder(&str, &arena, 4);
+    AppendString(&str, "Hello");
+    AppendString(&str, ", ");
+    AppendFormat(&str, "%s %d", "world", 42);
+    REQUIRE(strcmp(StringData(&str), "Hello, world 42") == 0);
+    REQUIRE(StringLength(&str) == 15);
+
+    ClearString(&str);
+    REQUIRE(StringData(&str)[0] == 0);
+    AppendFormat(&str, "%d", 7);
+    REQUIRE(strcmp(StringData(&str), "7") == 0);
+}
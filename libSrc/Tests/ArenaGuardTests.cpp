@@ -0,0 +1,95 @@
+/* ==========================================================================
+   $File: ArenaGuardTests.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#undef NDEBUG
+#define ARENA_GUARD_PUSHES
+#include "../MemoryLayout.hpp"
+#define CATCH_CONFIG_MAIN
+#include "../../Tests/catch.hpp"
+#include <sys/wait.h>
+#include <csignal>
+
+/// Run fn in a child process, returning the signal that killed it (0 if none)
+template <typename F>
+FileScope int RunInChild(F fn)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // NOTE(Chris): Catch's own handler would report and exit cleanly
+        signal(SIGSEGV, SIG_DFL);
+        fn();
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+}
+
+struct MappedArena
+{
+    MappedArena()
+    {
+        size = Megabytes(1);
+        mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        InitializeArena(&arena, size, mem);
+    }
+    ~MappedArena()
+    {
+        munmap(mem, size);
+    }
+
+    MemoryIndex size;
+    void* mem;
+    MemoryArena arena;
+};
+
+TEST_CASE("Writing past a guarded push faults", "[ArenaGuard]")
+{
+    MappedArena m;
+    u8* block = PushArray<u8>(&m.arena, 100, 16);
+    REQUIRE(m.arena.guards != nullptr);
+
+    REQUIRE(RunInChild([block]() { memset(block, 1, 112); }) == 0);
+    REQUIRE(RunInChild([block]() { memset(block, 1, 113); }) == SIGSEGV);
+}
+
+TEST_CASE("Guarded pushes can be aligned past a page", "[ArenaGuard]")
+{
+    MappedArena m;
+    MemoryIndex pageSize = (MemoryIndex)sysconf(_SC_PAGESIZE);
+    u8* block = PushArray<u8>(&m.arena, 100, 4 * pageSize);
+    REQUIRE(((MemoryIndex)block & (4 * pageSize - 1)) == 0);
+
+    REQUIRE(RunInChild([block, pageSize]() { memset(block, 1, pageSize); }) == 0);
+    REQUIRE(RunInChild([block, pageSize]() { memset(block, 1, pageSize + 1); }) == SIGSEGV);
+}
+
+TEST_CASE("Guard pages are released when the arena is rewound", "[ArenaGuard]")
+{
+    MappedArena m;
+    PushStruct<u64>(&m.arena);
+    MemoryIndex fill = m.arena.fillPoint;
+    ArenaGuard* outer = m.arena.guards;
+
+    {
+        ScopedTempBlock temp(&m.arena);
+        MemoryArena sub;
+        CreateSubArena(&sub, &m.arena, 1000);
+        PushArray<u8>(&m.arena, 5000);
+    }
+    REQUIRE(m.arena.fillPoint == fill);
+    REQUIRE(m.arena.guards == outer);
+
+    // NOTE(Chris): Everything past the first push is writable again
+    u8* rest = static_cast<u8*>(m.mem) + fill;
+    REQUIRE(RunInChild([rest]() { memset(rest, 1, Kilobytes(64)); }) == 0);
+
+    ResetArena(&m.arena);
+    REQUIRE(m.arena.guards == nullptr);
+    REQUIRE(RunInChild([&m]() { memset(m.mem, 1, m.size); }) == 0);
+}
@@ -0,0 +1,75 @@
+/* ==========================================================================
+   $File: ArenaStatsTests.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#define ARENA_INSTRUMENTATION
+#include "../MemoryLayout.hpp"
+#include "../ArenaContainers.hpp"
+#define CATCH_CONFIG_MAIN
+#include "../../Tests/catch.hpp"
+#include <vector>
+
+TEST_CASE("Arena stats track high water, waste and call sites", "[ArenaStats]")
+{
+    std::vector<u8> heap(Kilobytes(64));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    ArenaStats stats;
+    InitArenaStats(&stats, "test");
+    AttachArenaStats(&arena, &stats);
+
+    for (u32 i = 0; i < 4; ++i)
+    {
+        ScopedTempBlock temp(&arena);
+        PushBlock(&arena, 3, 1);
+        PushStruct<u64>(&arena, 8);
+    }
+    u32 line = __LINE__ - 2;
+    PushArray<u8>(&arena, 1000);
+
+    REQUIRE(stats.pushes == 9);
+    REQUIRE(stats.bytes == 4 * (3 + 8) + 1000);
+    // NOTE(Chris): 3 bytes in, a u64 needs 5 bytes of padding
+    REQUIRE(stats.alignmentWaste == 4 * 5);
+    REQUIRE(stats.highWater == 1000);
+
+    u32 numSites = 0;
+    bool foundStruct = false;
+    for (const ArenaSiteStats& site : stats.sites)
+    {
+        if (site.line == 0)
+            continue;
+        ++numSites;
+        if (site.line == line)
+        {
+            foundStruct = true;
+            REQUIRE(strcmp(site.file, "ArenaStatsTests.cpp") == 0);
+            REQUIRE(site.pushes == 4);
+            REQUIRE(site.bytes == 32);
+            REQUIRE(site.alignmentWaste == 20);
+        }
+    }
+    REQUIRE(numSites == 3);
+    REQUIRE(foundStruct);
+}
+
+TEST_CASE("Resizing a block in place is counted as a push", "[ArenaStats]")
+{
+    std::vector<u8> heap(Kilobytes(4));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    ArenaStats stats;
+    InitArenaStats(&stats, "test");
+    AttachArenaStats(&arena, &stats);
+
+    void* block = PushBlock(&arena, 100, 1);
+    REQUIRE(ResizeArenaBlock(&arena, block, 100, 300, 1) == block);
+    REQUIRE(stats.pushes == 2);
+    REQUIRE(stats.bytes == 300);
+    REQUIRE(stats.highWater == 300);
+}
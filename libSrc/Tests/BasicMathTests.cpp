@@ -0,0 +1,99 @@
+/* ==========================================================================
+   $File: BasicMathTests.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "../BasicMath.hpp"
+#define CATCH_CONFIG_MAIN
+#include "../../Tests/catch.hpp"
+
+static_assert(sizeof(v2) == 2 * sizeof(f32) && sizeof(v3) == 3 * sizeof(f32)
+              && sizeof(v4) == 4 * sizeof(f32), "Vectors must stay packed");
+static_assert(std::is_trivial<v3>::value && std::is_trivial<v4d>::value,
+              "Vectors must stay usable in unions and heap structs");
+
+TEST_CASE("Swizzles alias the components", "[BasicMath]")
+{
+    v3 a = V3(1.0f, 2.0f, 3.0f);
+    REQUIRE(a.xy == V2(1.0f, 2.0f));
+    REQUIRE(a.yz == V2(2.0f, 3.0f));
+    REQUIRE(a.uv.v == 2.0f);
+    REQUIRE(a.vw.u == 2.0f);
+    a.yz += V2(10.0f, 10.0f);
+    REQUIRE(a == V3(1.0f, 12.0f, 13.0f));
+    REQUIRE(a.r == 1.0f);
+    REQUIRE(a.l == 13.0f);
+
+    v4 b = V4(a, 4.0f);
+    REQUIRE(b.xyz == a);
+    REQUIRE(b.rgb == a);
+    REQUIRE(b.yzw == V3(12.0f, 13.0f, 4.0f));
+    REQUIRE(b.zw == V2(13.0f, 4.0f));
+    REQUIRE(b.a == 4.0f);
+    REQUIRE(b[2] == 13.0f);
+}
+
+TEST_CASE("Vector arithmetic is component-wise", "[BasicMath]")
+{
+    v3 a = V3(1.0f, 2.0f, 3.0f);
+    v3 b = V3(4.0f, 5.0f, 6.0f);
+    REQUIRE(a + b == V3(5.0f, 7.0f, 9.0f));
+    REQUIRE(b - a == V3(3.0f, 3.0f, 3.0f));
+    REQUIRE(a * b == V3(4.0f, 10.0f, 18.0f));
+    REQUIRE(b / a == V3(4.0f, 2.5f, 2.0f));
+    REQUIRE(a * 2 == V3(2.0f, 4.0f, 6.0f));
+    REQUIRE(6.0f / a == V3(6.0f, 3.0f, 2.0f));
+    REQUIRE(-a == V3(-1.0f, -2.0f, -3.0f));
+
+    v3i c = MakeVec(1, -2, 3);
+    c *= 3;
+    REQUIRE(c == MakeVec(3, -6, 9));
+    REQUIRE(Abs(c) == MakeVec(3, 6, 9));
+    REQUIRE(Clamp(c, -5, 5) == MakeVec(3, -5, 5));
+    REQUIRE(Min(c, Splat<i32, 3>(0)) == MakeVec(0, -6, 0));
+}
+
+TEST_CASE("Products and lengths", "[BasicMath]")
+{
+    v3 x = V3(1.0f, 0.0f, 0.0f);
+    v3 y = V3(0.0f, 1.0f, 0.0f);
+    REQUIRE(Cross(x, y) == V3(0.0f, 0.0f, 1.0f));
+    REQUIRE(Dot(x, y) == 0.0f);
+    REQUIRE(Dot(V3(1.0f, 2.0f, 3.0f), V3(4.0f, 5.0f, 6.0f)) == 32.0f);
+
+    REQUIRE(Length(V2(3.0f, 4.0f)) == 5.0f);
+    REQUIRE(Length(MakeVec(3, 4)) == 5.0);
+    REQUIRE(Equals(Length(Normalize(V3(1.0f, -7.0f, 2.5f))), 1.0f));
+    REQUIRE(Equals(Lerp(x, y, 0.25f), V3(0.75f, 0.25f, 0.0f)));
+}
+
+TEST_CASE("SIMD vectors match the generic versions", "[BasicMath]")
+{
+    v4 a = V4(1.5f, -2.0f, 3.25f, 8.0f);
+    v4 b = V4(-4.0f, 0.5f, 2.0f, 1.0f);
+    v4d ad = MakeVec(1.5, -2.0, 3.25, 8.0);
+    v4d bd = MakeVec(-4.0, 0.5, 2.0, 1.0);
+    for (u32 i = 0; i < 4; ++i)
+    {
+        REQUIRE((a + b)[i] == a[i] + b[i]);
+        REQUIRE((a - b)[i] == a[i] - b[i]);
+        REQUIRE((a * b)[i] == a[i] * b[i]);
+        REQUIRE((a / b)[i] == a[i] / b[i]);
+        REQUIRE((a * 3.0f)[i] == a[i] * 3.0f);
+        REQUIRE((2.0f - a)[i] == 2.0f - a[i]);
+        REQUIRE((-a)[i] == -a[i]);
+        REQUIRE(Min(a, b)[i] == Min(a[i], b[i]));
+        REQUIRE(Max(a, b)[i] == Max(a[i], b[i]));
+        REQUIRE((ad * bd)[i] == ad[i] * bd[i]);
+        REQUIRE((ad + 1.0)[i] == ad[i] + 1.0);
+        REQUIRE(Max(ad, bd)[i] == Max(ad[i], bd[i]));
+    }
+    REQUIRE(Dot(a, b) == -6.0f - 1.0f + 6.5f + 8.0f);
+    REQUIRE(Dot(ad, bd) == -6.0 - 1.0 + 6.5 + 8.0);
+    REQUIRE(Equals(Length(Normalize(a)), 1.0f));
+
+    a += b;
+    REQUIRE(a == V4(-2.5f, -1.5f, 5.25f, 9.0f));
+}
@@ -0,0 +1,74 @@
+/* ==========================================================================
+   $File: HeapPlanTests.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "../MemoryLayout.hpp"
+#define CATCH_CONFIG_MAIN
+#include "../../Tests/catch.hpp"
+#include <vector>
+
+struct alignas(16) Particle
+{
+    f32 x, y, z;
+    u32 life;
+    u8 flags;
+};
+
+typedef HeapPlan<PlanArray<u8, 3>,
+                 PlanArray<Particle, 10>,
+                 PlanBytes<100, 4096>,
+                 PlanArray<u64>> TestPlan;
+
+static_assert(TestPlan::NumItems == 4, "");
+static_assert(TestPlan::Offset<0>() == 0, "");
+static_assert(TestPlan::Offset<1>() == 16, "");
+static_assert(TestPlan::ItemSize<1>() == 10 * sizeof(Particle), "");
+static_assert(TestPlan::Offset<2>() == 4096, "");
+static_assert(TestPlan::Offset<3>() == 4200, "");
+static_assert(TestPlan::Size() == 4208, "");
+static_assert(TestPlan::Alignment() == 4096, "");
+static_assert(TestPlan::Padding() == 13 + (4096 - 16 - 10 * sizeof(Particle)) + 4, "");
+
+// NOTE(Chris): Nested plans are laid out at their own alignment
+typedef HeapPlan<PlanArray<u8>, TestPlan, PlanBytes<100, 1, 3>> NestedPlan;
+static_assert(NestedPlan::Offset<1>() == 4096, "");
+static_assert(NestedPlan::Offset<2>() == 4096 + 4208, "");
+static_assert(NestedPlan::Size() == 4096 + 4208 + 300, "");
+
+static_assert(PersistantHeapPlan::Size() <= PersistantHeapSize, "");
+static_assert(WorkingHeapPlan::Size() <= WorkingHeapSize, "");
+
+TEST_CASE("Pushes in plan order fit the plan", "[HeapPlan]")
+{
+    std::vector<u8> heap(TestPlan::Size() + TestPlan::Alignment());
+    u8* base = reinterpret_cast<u8*>(PlanAlignUp((MemoryIndex)heap.data(), TestPlan::Alignment()));
+    MemoryArena arena;
+    InitializeArena(&arena, TestPlan::Size(), base);
+
+    REQUIRE(PushArray<u8>(&arena, 3, 1) == base + TestPlan::Offset<0>());
+    REQUIRE((u8*)PushArray<Particle>(&arena, 10, alignof(Particle)) == base + TestPlan::Offset<1>());
+    REQUIRE(PushBlock(&arena, 100, 4096) == base + TestPlan::Offset<2>());
+    REQUIRE((u8*)PushStruct<u64>(&arena, alignof(u64)) == base + TestPlan::Offset<3>());
+    REQUIRE(arena.fillPoint == TestPlan::Size());
+}
+
+TEST_CASE("Regions fit what's planned for them", "[HeapPlan]")
+{
+    typedef HeapPlan<PlanArray<u32, 5>, PlanBytes<Kilobytes(8), Kilobytes(4), 2>> Contents;
+    typedef PlanRegion<Contents> Region;
+    std::vector<u8> heap(Region::Size() + Region::Alignment());
+    u8* base = reinterpret_cast<u8*>(PlanAlignUp((MemoryIndex)heap.data(), Region::Alignment()));
+
+    MemoryArena arena;
+    InitializeArena(&arena, Region::Size() - RegionArenaOffset, base + RegionArenaOffset);
+    PushArray<u32>(&arena, 5, alignof(u32));
+    PushBlock(&arena, Kilobytes(8), Kilobytes(4));
+    PushBlock(&arena, Kilobytes(8), Kilobytes(4));
+    // NOTE(Chris): The plan allows for the arena header pushing the
+    // contents out by up to their alignment
+    REQUIRE(arena.fillPoint <= arena.size);
+    REQUIRE(GetRemainingArenaSize(&arena, 1) <= Contents::Alignment());
+}
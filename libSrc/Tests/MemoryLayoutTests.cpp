@@ -0,0 +1,369 @@
+/* ==========================================================================
+   $File: MemoryLayoutTests.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "../MemoryLayout.hpp"
+#define CATCH_CONFIG_MAIN
+#include "../../Tests/catch.hpp"
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+TEST_CASE("Scratch arenas are per thread and kept across frames", "[MemoryLayout]")
+{
+    std::vector<u8> heap(Megabytes(2));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    ScratchArenas scratch;
+    InitScratchArenas(&scratch, &arena, Kilobytes(16));
+    REQUIRE(arena.fillPoint >= ScratchArenas::MaxThreads * Kilobytes(16));
+
+    MemoryArena* mine = GetScratchArena(&scratch);
+    REQUIRE(mine != nullptr);
+    REQUIRE(GetScratchArena(&scratch) == mine);
+    PushArray<u32>(mine, 100);
+
+    const u32 numThreads = 8;
+    std::vector<MemoryArena*> theirs(numThreads);
+    std::vector<std::thread> threads;
+    for (u32 i = 0; i < numThreads; ++i)
+    {
+        threads.emplace_back([&scratch, &theirs, i]() {
+            MemoryArena* arena = GetScratchArena(&scratch);
+            theirs[i] = arena;
+            for (u32 j = 0; j < 64; ++j)
+                *PushStruct<u64>(arena, 8) = j;
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    theirs.push_back(mine);
+    std::sort(theirs.begin(), theirs.end());
+    REQUIRE(std::unique(theirs.begin(), theirs.end()) == theirs.end());
+    REQUIRE(scratch.numClaimed.load() == numThreads + 1);
+
+    ResetScratchArenas(&scratch);
+    REQUIRE(scratch.numClaimed.load() == numThreads + 1);
+    for (u32 i = 0; i < ScratchArenas::MaxThreads; ++i)
+        REQUIRE(scratch.arenas[i].fillPoint == 0);
+    REQUIRE(GetScratchArena(&scratch) == mine);
+
+    // NOTE(Chris): The old claim is stale once they're released
+    ReleaseScratchClaims(&scratch);
+    REQUIRE(scratch.numClaimed.load() == 0);
+    MemoryArena* next = GetScratchArena(&scratch);
+    REQUIRE(next == &scratch.arenas[0]);
+    REQUIRE(scratch.numClaimed.load() == 1);
+}
+
+TEST_CASE("Scratch arenas run out rather than share", "[MemoryLayout]")
+{
+    std::vector<u8> heap(Megabytes(1));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    ScratchArenas scratch;
+    InitScratchArenas(&scratch, &arena, Kilobytes(4));
+
+    std::vector<MemoryArena*> claims(ScratchArenas::MaxThreads + 1);
+    for (u32 i = 0; i < claims.size(); ++i)
+        std::thread([&scratch, &claims, i]() { claims[i] = GetScratchArena(&scratch); }).join();
+
+    REQUIRE(std::count(claims.begin(), claims.end(), nullptr) == 1);
+    ResetScratchArenas(&scratch);
+}
+
+TEST_CASE("Atomic pushes never overlap", "[MemoryLayout]")
+{
+    const u32 numThreads = 8;
+    const u32 numPushes = 1000;
+    // NOTE(Chris): Exactly enough for every push, 24 bytes at a 16 byte stride
+    std::vector<u8> heap(numThreads * numPushes * 32 + 16);
+    u8* base = reinterpret_cast<u8*>(((MemoryIndex)heap.data() + 15) & ~(MemoryIndex)15);
+    MemoryArena arena;
+    InitializeArena(&arena, numThreads * numPushes * 32 - 8, base);
+
+    std::vector<std::vector<u8*>> blocks(numThreads);
+    std::vector<std::thread> threads;
+    for (u32 i = 0; i < numThreads; ++i)
+    {
+        threads.emplace_back([&arena, &blocks, i]() {
+            for (u32 j = 0; j < numPushes; ++j)
+            {
+                u8* block = static_cast<u8*>(PushBlockAtomic(&arena, 24, 16));
+                memset(block, (int)i, 24);
+                blocks[i].push_back(block);
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    std::vector<u8*> all;
+    for (u32 i = 0; i < numThreads; ++i)
+    {
+        for (u8* block : blocks[i])
+        {
+            REQUIRE(((MemoryIndex)block & 15) == 0);
+            REQUIRE(std::count(block, block + 24, (u8)i) == 24);
+            all.push_back(block);
+        }
+    }
+    std::sort(all.begin(), all.end());
+    for (size_t i = 1; i < all.size(); ++i)
+        REQUIRE(all[i] - all[i - 1] >= 24);
+
+    REQUIRE(arena.fillPoint == arena.size);
+    REQUIRE(PushBlockAtomic(&arena, 24, 16) == nullptr);
+    REQUIRE(PushBlockAtomic(&arena, 1, 1) == nullptr);
+    REQUIRE(arena.fillPoint == arena.size);
+}
+
+TEST_CASE("Growable arenas chain on new blocks", "[MemoryLayout]")
+{
+    std::vector<u8> first(Kilobytes(1));
+    MemoryArena arena;
+    InitializeGrowableArena(&arena, first.size(), first.data(), Kilobytes(4));
+
+    u8* a = PushArray<u8>(&arena, 1000);
+    REQUIRE(a == first.data());
+    REQUIRE(arena.chain == nullptr);
+
+    TempBlock temp = CreateTempBlock(&arena);
+    u8* b = PushArray<u8>(&arena, 100);
+    REQUIRE(arena.chain != nullptr);
+    REQUIRE((b < first.data() || b >= first.data() + first.size()));
+
+    // NOTE(Chris): Bigger than minBlockSize, gets its own block
+    u32* c = PushArray<u32>(&arena, Kilobytes(4), 16);
+    REQUIRE(((MemoryIndex)c & 15) == 0);
+    c[Kilobytes(4) - 1] = 1;
+    REQUIRE(arena.chain->prev != nullptr);
+
+    ClearTempBlock(temp);
+    REQUIRE(arena.chain == nullptr);
+    REQUIRE(arena.blockStart == first.data());
+    REQUIRE(arena.fillPoint == 1000);
+
+    PushArray<u8>(&arena, 2000);
+    ResetArena(&arena);
+    REQUIRE(arena.chain == nullptr);
+    REQUIRE(arena.fillPoint == 0);
+}
+
+TEST_CASE("Growable arenas can take blocks from another arena", "[MemoryLayout]")
+{
+    std::vector<u8> heap(Kilobytes(64));
+    MemoryArena parent;
+    InitializeArena(&parent, heap.size(), heap.data());
+
+    MemoryArena child;
+    CreateSubArena(&child, &parent, 256);
+    child.growth = ArenaGrowth::FromArena;
+    child.growFrom = &parent;
+    child.minBlockSize = Kilobytes(1);
+
+    MemoryIndex parentFill = parent.fillPoint;
+    TempBlock temp = CreateTempBlock(&child);
+    PushArray<u8>(&child, 512);
+    REQUIRE(parent.fillPoint >= parentFill + Kilobytes(1));
+
+    // NOTE(Chris): The block is on top of the parent, so it's handed back
+    ClearTempBlock(temp);
+    REQUIRE(parent.fillPoint == parentFill);
+}
+
+TEST_CASE("ZeroStruct clears the whole struct", "[MemoryLayout]")
+{
+    struct Big { u64 a[16]; } big;
+    memset(&big, 0xFF, sizeof(big));
+    ZeroStruct(&big);
+    for (u64 v : big.a)
+        REQUIRE(v == 0);
+}
+
+TEST_CASE("Zeroing works at every size and alignment", "[MemoryLayout]")
+{
+    std::vector<u8> buf(Megabytes(1) + 256);
+    for (auto zero : {ZeroBlock, ZeroBlockStreaming})
+    {
+        for (MemoryIndex size : {(MemoryIndex)0, (MemoryIndex)1, (MemoryIndex)63,
+                                 (MemoryIndex)4096, (MemoryIndex)Megabytes(1) + 77})
+        {
+            for (MemoryIndex offset = 0; offset < 32; offset += 7)
+            {
+                memset(buf.data(), 0xAB, buf.size());
+                zero(buf.data() + offset, size);
+                REQUIRE(std::count(buf.begin() + offset, buf.begin() + offset + size, 0) == (i64)size);
+                REQUIRE(buf[offset + size] == 0xAB);
+                if (offset)
+                    REQUIRE(buf[offset - 1] == 0xAB);
+            }
+        }
+    }
+}
+
+TEST_CASE("Arenas can be cleared by discarding pages", "[MemoryLayout]")
+{
+    MemoryIndex size = Megabytes(4);
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(mem != MAP_FAILED);
+
+    MemoryArena arena;
+    InitializeArena(&arena, size, mem);
+    u8* block = PushArray<u8>(&arena, Megabytes(2) + 123);
+    memset(block, 0xCD, Megabytes(2) + 123);
+    u8* after = static_cast<u8*>(mem) + Megabytes(2) + 123;
+    *after = 0xEE;
+
+    ClearArena(&arena, true);
+    REQUIRE(arena.fillPoint == 0);
+    REQUIRE(std::count(block, block + Megabytes(2) + 123, 0) == (i64)(Megabytes(2) + 123));
+    REQUIRE(*after == 0xEE);
+    munmap(mem, size);
+}
+
+TEST_CASE("Scoped temp blocks rewind on scope exit", "[MemoryLayout]")
+{
+    std::vector<u8> heap(Kilobytes(16));
+    MemoryArena arena;
+    InitializeGrowableArena(&arena, Kilobytes(1), heap.data(), Kilobytes(4));
+    PushArray<u8>(&arena, 100);
+
+    for (u32 i = 0; i < 100; ++i)
+    {
+        ScopedTempBlock outer(&arena);
+        PushArray<u8>(&arena, 500);
+        {
+            ScopedTempBlock inner(&arena);
+            REQUIRE(inner.block.depth == 2);
+            PushArray<u8>(&arena, 1000);
+        }
+        REQUIRE(arena.tempCount == 1);
+        REQUIRE(arena.fillPoint >= 600);
+    }
+    REQUIRE(arena.fillPoint == 100);
+    REQUIRE(arena.chain == nullptr);
+    CheckArenaNoTemps(&arena);
+}
+
+TEST_CASE("Regions are reset by lifetime", "[MemoryLayout]")
+{
+    CompleteState state{};
+    MemoryArena arenas[Region_Count];
+    std::vector<u8> heap(Kilobytes(1) * Region_Count);
+    const RegionLifetime lifetimes[Region_Count] =
+        {RegionLifetime::Permanent, RegionLifetime::Level, RegionLifetime::Frame,
+         RegionLifetime::Transient, RegionLifetime::Working};
+    for (u32 i = 0; i < Region_Count; ++i)
+    {
+        InitializeArena(&arenas[i], Kilobytes(1), heap.data() + i * Kilobytes(1));
+        state.regions[i].lifetime = lifetimes[i];
+        state.regions[i].arena = &arenas[i];
+        PushArray<u8>(GetRegionArena(&state, (RegionId)i), 100);
+    }
+
+    ResetRegions(&state, RegionLifetime::Frame);
+    REQUIRE(arenas[Region_Frame].fillPoint == 0);
+    REQUIRE(arenas[Region_Level].fillPoint == 100);
+    REQUIRE(arenas[Region_GpuStaging].fillPoint == 100);
+
+    ResetRegion(&state, Region_GpuStaging);
+    REQUIRE(arenas[Region_GpuStaging].fillPoint == 0);
+    ResetRegions(&state, RegionLifetime::Level);
+    REQUIRE(arenas[Region_Level].fillPoint == 0);
+    REQUIRE(arenas[Region_Permanent].fillPoint == 100);
+    REQUIRE(arenas[Region_Working].fillPoint == 100);
+
+    // NOTE(Chris): The working region holds live scratch arenas
+    ResetRegions(&state, RegionLifetime::Permanent);
+    REQUIRE(arenas[Region_Permanent].fillPoint == 0);
+    REQUIRE(arenas[Region_Working].fillPoint == 100);
+    ResetRegions(&state, RegionLifetime::Working);
+    REQUIRE(arenas[Region_Working].fillPoint == 100);
+}
+
+TEST_CASE("Frame arenas flip without a consumer", "[MemoryLayout]")
+{
+    std::vector<u8> heap(Kilobytes(16));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+    FrameArenas<3> frames;
+    InitFrameArenas(&frames, &arena, Kilobytes(1));
+    REQUIRE(AcquireReadArena(&frames) == nullptr);
+
+    for (u32 i = 0; i < 10; ++i)
+    {
+        REQUIRE(GetWriteArena(&frames) == &frames.arenas[i % 3]);
+        REQUIRE(GetWriteArena(&frames)->fillPoint == 0);
+        *PushStruct<u32>(GetWriteArena(&frames)) = i;
+        FlipFrameArenas(&frames);
+    }
+
+    u64 frame;
+    const MemoryArena* read = AcquireReadArena(&frames, &frame);
+    REQUIRE(frame == 9);
+    REQUIRE(*reinterpret_cast<const u32*>(read->blockStart) == 9);
+    ReleaseReadArena(&frames);
+}
+
+TEST_CASE("Frame arenas aren't reset while being read", "[MemoryLayout]")
+{
+    std::vector<u8> heap(Kilobytes(64));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+    FrameArenas<2> frames;
+    InitFrameArenas(&frames, &arena, Kilobytes(8));
+
+    constexpr u32 NumFrames = 2000;
+    constexpr u32 ValuesPerFrame = 1000;
+    std::atomic<bool> done(false);
+    std::atomic<u32> badFrames(0);
+    std::atomic<u32> framesRead(0);
+
+    std::thread consumer([&]()
+    {
+        u64 lastFrame = ~(u64)0;
+        while (!done.load())
+        {
+            u64 frame;
+            const MemoryArena* read = AcquireReadArena(&frames, &frame);
+            if (read && frame != lastFrame)
+            {
+                const u32* values = reinterpret_cast<const u32*>(read->blockStart);
+                for (u32 i = 0; i < ValuesPerFrame; ++i)
+                {
+                    if (values[i] != (u32)frame)
+                    {
+                        ++badFrames;
+                        break;
+                    }
+                }
+                lastFrame = frame;
+                ++framesRead;
+            }
+            ReleaseReadArena(&frames);
+        }
+    });
+
+    for (u32 f = 0; f < NumFrames; ++f)
+    {
+        u32* values = PushArray<u32>(GetWriteArena(&frames), ValuesPerFrame);
+        for (u32 i = 0; i < ValuesPerFrame; ++i)
+            values[i] = f;
+        FlipFrameArenas(&frames);
+    }
+    // NOTE(Chris): The last frame stays readable however far behind the
+    // consumer is
+    while (framesRead.load() == 0)
+        std::this_thread::yield();
+    done.store(true);
+    consumer.join();
+
+    REQUIRE(badFrames.load() == 0);
+}
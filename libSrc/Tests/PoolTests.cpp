@@ -0,0 +1,77 @@
+/* ==========================================================================
+   $File: PoolTests.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "../Pool.hpp"
+#define CATCH_CONFIG_MAIN
+#include "../../Tests/catch.hpp"
+#include <vector>
+
+struct Particle
+{
+    f32 x, y;
+    u32 life;
+};
+
+TEST_CASE("Pools allocate and recycle slots", "[Pool]")
+{
+    std::vector<u8> heap(Kilobytes(64));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    Pool<Particle, 16> pool;
+    InitPool(&pool, &arena, 40);
+    REQUIRE(pool.maxSlabs == 3);
+
+    Particle* p = nullptr;
+    PoolHandle a = PoolAlloc(&pool, &p);
+    REQUIRE(!IsNullHandle(a));
+    REQUIRE(((MemoryIndex)pool.slabs[0] % CacheLineSize) == 0);
+    p->life = 10;
+    REQUIRE(PoolGet(&pool, a)->life == 10);
+
+    PoolHandle b = PoolAlloc(&pool);
+    REQUIRE(PoolFree(&pool, a));
+    REQUIRE(PoolGet(&pool, a) == nullptr);
+    REQUIRE(!PoolFree(&pool, a));
+
+    // NOTE(Chris): Reuses a's slot, but a stays stale
+    PoolHandle c = PoolAlloc(&pool);
+    REQUIRE(c.index == a.index);
+    REQUIRE(c.generation != a.generation);
+    REQUIRE(PoolGet(&pool, a) == nullptr);
+    REQUIRE(PoolGet(&pool, c)->life == 0);
+    REQUIRE(PoolGet(&pool, b) != nullptr);
+    REQUIRE(pool.numLive == 2);
+}
+
+TEST_CASE("Pools stop at their capacity", "[Pool]")
+{
+    std::vector<u8> heap(Kilobytes(64));
+    MemoryArena arena;
+    InitializeArena(&arena, heap.size(), heap.data());
+
+    Pool<u64, 8> pool;
+    InitPool(&pool, &arena, 16);
+
+    std::vector<PoolHandle> handles;
+    for (u32 i = 0; i < 16; ++i)
+    {
+        u64* value = nullptr;
+        handles.push_back(PoolAlloc(&pool, &value));
+        *value = i;
+    }
+    REQUIRE(pool.numSlabs == 2);
+    REQUIRE(IsNullHandle(PoolAlloc(&pool)));
+
+    MemoryIndex fill = arena.fillPoint;
+    for (PoolHandle h : handles)
+        REQUIRE(PoolFree(&pool, h));
+    for (u32 i = 0; i < 16; ++i)
+        REQUIRE(!IsNullHandle(PoolAlloc(&pool)));
+    REQUIRE(arena.fillPoint == fill);
+    REQUIRE(PoolGet(&pool, PoolHandle{0, 0}) == nullptr);
+}
@@ -0,0 +1,27 @@
+/* ==========================================================================
+   $File: ReloadTestLib.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Stand-in for libLoop in ReloadTests.cpp, built once per
+   RELOAD_TEST_VERSION so the two builds disagree on ReloadState.
+   ========================================================================== */
+
+#include "../MemoryLayout.hpp"
+
+#if RELOAD_TEST_VERSION == 1
+#define RELOAD_STATE_FIELDS(Field)              \
+    Field(bool, initialized)                    \
+    Field(f32, time)
+#else
+#define RELOAD_STATE_FIELDS(Field)              \
+    Field(bool, initialized)                    \
+    Field(f32, time)                            \
+    Field(u64, addedField)
+#endif
+HEAP_STRUCT(ReloadState, RELOAD_STATE_FIELDS);
+
+extern "C" const HeapRoot reloadRoot =
+    {&LayoutOf<ReloadState>::Get, HeapId::Persistant, 0, Kilobytes(4)};
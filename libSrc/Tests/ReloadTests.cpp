@@ -0,0 +1,76 @@
+/* ==========================================================================
+   $File: ReloadTests.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Loads two builds of ReloadTestLib.cpp, as a reload would, and checks
+   each keeps its own layouts. Build the libraries with the flags Loop
+   gets in libSrc/CMakeLists.txt, next to the test:
+     g++ -std=c++11 -shared -fPIC -fno-gnu-unique -DRELOAD_TEST_VERSION=1 \
+         ReloadTestLib.cpp -o ReloadTestLib1.so
+     g++ -std=c++11 -shared -fPIC -fno-gnu-unique -DRELOAD_TEST_VERSION=2 \
+         ReloadTestLib.cpp -o ReloadTestLib2.so
+     g++ -std=c++11 ReloadTests.cpp ../../src/StateMigration.cpp -ldl -o ReloadTests
+   ========================================================================== */
+
+#include "../MemoryLayout.hpp"
+#include "../../src/StateMigration.hpp"
+#define CATCH_CONFIG_MAIN
+#include "../../Tests/catch.hpp"
+#include <dlfcn.h>
+#include <vector>
+
+FileScope const HeapRoot* LoadRoot(void* handle)
+{
+    return handle ? static_cast<const HeapRoot*>(dlsym(handle, "reloadRoot")) : nullptr;
+}
+
+TEST_CASE("A reloaded build brings its own layouts", "[Reload]")
+{
+    void* first = dlopen("./ReloadTestLib1.so", RTLD_NOW | RTLD_LOCAL);
+    void* second = dlopen("./ReloadTestLib2.so", RTLD_NOW | RTLD_LOCAL);
+    const HeapRoot* firstRoot = LoadRoot(first);
+    const HeapRoot* secondRoot = LoadRoot(second);
+    REQUIRE(firstRoot != nullptr);
+    REQUIRE(secondRoot != nullptr);
+
+    // NOTE(Chris): With GNU_UNIQUE statics the second build's Get would
+    // hand back the first build's layout
+    const StructLayout& firstLayout = firstRoot->layout();
+    const StructLayout& secondLayout = secondRoot->layout();
+    REQUIRE(&firstLayout != &secondLayout);
+    REQUIRE(firstLayout.numFields == 2);
+    REQUIRE(secondLayout.numFields == 3);
+
+    std::vector<u8> heap(Kilobytes(4));
+    CompleteState state{};
+    state.persistantHeap = heap.data();
+    state.persistantHeapSize = heap.size();
+
+    REQUIRE(MigrateHeapRoots(&state, firstRoot, 1) == 0);
+    u8* data = static_cast<u8*>(GetHeapRootData(&state, *firstRoot));
+    f32 time = 12.5f;
+    memcpy(data + firstLayout.fields[1].offset, &time, sizeof(time));
+
+    REQUIRE(MigrateHeapRoots(&state, secondRoot, 1) == 1);
+    REQUIRE(GetHeapRootHeader(&state, *secondRoot)->signature == secondLayout.signature);
+    f32 migrated;
+    memcpy(&migrated, data + secondLayout.fields[1].offset, sizeof(migrated));
+    REQUIRE(migrated == time);
+
+    dlclose(second);
+    dlclose(first);
+}
+
+TEST_CASE("A closed build is unmapped", "[Reload]")
+{
+    void* handle = dlopen("./ReloadTestLib1.so", RTLD_NOW | RTLD_LOCAL);
+    REQUIRE(LoadRoot(handle) != nullptr);
+    dlclose(handle);
+
+    // NOTE(Chris): GNU_UNIQUE symbols would have made it NODELETE
+    void* still = dlopen("./ReloadTestLib1.so", RTLD_LAZY | RTLD_NOLOAD);
+    REQUIRE(still == nullptr);
+}
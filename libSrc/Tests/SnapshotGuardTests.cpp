@@ -0,0 +1,63 @@
+/* ==========================================================================
+   $File: SnapshotGuardTests.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Guarded pushes alongside snapshots of the persistent heap, which the
+   host reads page by page. Needs the host's regions and snapshots:
+     g++ -std=c++11 SnapshotGuardTests.cpp ../../src/MemoryRegions.cpp \
+         ../../src/HeapSnapshot.cpp ../../src/DirtyPageTracker.cpp -o SnapshotGuardTests
+   ========================================================================== */
+
+#undef NDEBUG
+#define ARENA_GUARD_PUSHES
+#include "../MemoryLayout.hpp"
+#include "../../src/MemoryRegions.hpp"
+#include "../../src/HeapSnapshot.hpp"
+#define CATCH_CONFIG_MAIN
+#include "../../Tests/catch.hpp"
+#include <cstdlib>
+
+TEST_CASE("Persistent regions are never guarded", "[ArenaGuard]")
+{
+    MemoryIndex heapSize = PersistantHeapSize + WorkingHeapSize;
+    void* heap = mmap(nullptr, heapSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    REQUIRE(heap != MAP_FAILED);
+
+    CompleteState state{};
+    state.persistantHeap = heap;
+    state.persistantHeapSize = PersistantHeapSize;
+    state.workingHeap = static_cast<u8*>(heap) + PersistantHeapSize;
+    state.workingHeapSize = WorkingHeapSize;
+    InitMemoryRegions(&state);
+
+    MemoryArena* level = GetRegionArena(&state, Region_Level);
+    MemoryArena sub;
+    CreateSubArena(&sub, level, Kilobytes(64));
+    PushArray<u8>(GetRegionArena(&state, Region_Permanent), 100);
+    PushArray<u8>(&sub, 100);
+    REQUIRE(GetRegionArena(&state, Region_Permanent)->guards == nullptr);
+    REQUIRE(level->guards == nullptr);
+    REQUIRE(sub.guards == nullptr);
+
+    PushArray<u8>(GetRegionArena(&state, Region_Frame), 100);
+    REQUIRE(GetRegionArena(&state, Region_Frame)->guards != nullptr);
+
+    char path[] = "/tmp/SnapshotGuardTestsXXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    close(fd);
+
+    HeapSnapshot snap;
+    REQUIRE(OpenHeapSnapshot(&snap, path, state.persistantHeap, state.persistantHeapSize));
+    MemoryIndex pagesWritten = 0;
+    REQUIRE(SaveHeapSnapshot(&snap, &pagesWritten));
+    REQUIRE(pagesWritten > 0);
+    CloseHeapSnapshot(&snap);
+
+    unlink(path);
+    munmap(heap, heapSize);
+}
@@ -0,0 +1,56 @@
+/* ==========================================================================
+   $File: StateLayoutTests.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "../StateLayout.hpp"
+#define CATCH_CONFIG_MAIN
+#include "../../Tests/catch.hpp"
+#include <cstring>
+
+#define BASE_FIELDS(Field) Field(bool, initialized) Field(f32, time)
+HEAP_STRUCT(Base, BASE_FIELDS);
+
+#define SAME_FIELDS(Field) Field(bool, initialized) Field(f32, time)
+HEAP_STRUCT(Same, SAME_FIELDS);
+
+#define RETYPED_FIELDS(Field) Field(bool, initialized) Field(f64, time)
+HEAP_STRUCT(Retyped, RETYPED_FIELDS);
+
+#define REORDERED_FIELDS(Field) Field(f32, time) Field(bool, initialized)
+HEAP_STRUCT(Reordered, REORDERED_FIELDS);
+
+#define RENAMED_FIELDS(Field) Field(bool, initialised) Field(f32, time)
+HEAP_STRUCT(Renamed, RENAMED_FIELDS);
+
+TEST_CASE("Layout signatures are compile time constants", "[StateLayout]")
+{
+    static_assert(LayoutOf<Base>::Signature != 0, "Signature should be non-zero");
+    static_assert(LayoutOf<Base>::NumFields == 2, "Wrong field count");
+    REQUIRE(LayoutOf<Base>::Get().signature == (u64)LayoutOf<Base>::Signature);
+}
+
+TEST_CASE("Layout signatures track layout changes", "[StateLayout]")
+{
+    // NOTE(Chris): The struct name is part of the signature
+    REQUIRE((u64)LayoutOf<Base>::Signature != (u64)LayoutOf<Same>::Signature);
+    REQUIRE((u64)LayoutOf<Same>::Signature != (u64)LayoutOf<Retyped>::Signature);
+    REQUIRE((u64)LayoutOf<Same>::Signature != (u64)LayoutOf<Reordered>::Signature);
+    REQUIRE((u64)LayoutOf<Same>::Signature != (u64)LayoutOf<Renamed>::Signature);
+}
+
+TEST_CASE("Field tables describe the struct", "[StateLayout]")
+{
+    const StructLayout& layout = LayoutOf<Reordered>::Get();
+    REQUIRE(strcmp(layout.name, "Reordered") == 0);
+    REQUIRE(layout.size == sizeof(Reordered));
+    REQUIRE(layout.numFields == 2);
+    REQUIRE(strcmp(layout.fields[0].name, "time") == 0);
+    REQUIRE(layout.fields[0].offset == offsetof(Reordered, time));
+    REQUIRE(layout.fields[0].size == sizeof(f32));
+    REQUIRE(layout.fields[1].offset == offsetof(Reordered, initialized));
+    REQUIRE(layout.fields[0].typeHash == LayoutOf<Base>::Get().fields[1].typeHash);
+    REQUIRE(LayoutOf<Retyped>::Get().fields[1].typeHash != LayoutOf<Base>::Get().fields[1].typeHash);
+}
@@ -0,0 +1,86 @@
+/* ==========================================================================
+   $File: ZeroBench.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   ZeroBlock/DiscardBlock throughput against memset. Not a test, build
+   and run by hand:
+     g++ -std=c++11 -O2 ZeroBench.cpp -o ZeroBench
+   ========================================================================== */
+
+#include "../MemoryLayout.hpp"
+#include <chrono>
+#include <cstdio>
+
+typedef void (*ZeroFn)(void* block, MemoryIndex size);
+
+FileScope void Memset(void* block, MemoryIndex size)
+{
+    memset(block, 0, size);
+}
+
+/// GiB/s zeroing size bytes, repeated to cover about total bytes
+FileScope f64 RunBench(ZeroFn fn, u8* buf, MemoryIndex size, MemoryIndex total, bool dirty)
+{
+    MemoryIndex reps = total / size;
+    std::chrono::duration<f64> elapsed(0);
+    if (!dirty)
+    {
+        // NOTE(Chris): Small sizes are timed as a batch, reading the
+        // clock per call would swamp them
+        auto start = std::chrono::steady_clock::now();
+        for (MemoryIndex i = 0; i < reps; ++i)
+        {
+            fn(buf, size);
+            // NOTE(Chris): Stop the compiler treating the clear as dead
+            asm volatile("" : : "r"(buf) : "memory");
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    else
+    {
+        for (MemoryIndex i = 0; i < reps; ++i)
+        {
+            // NOTE(Chris): Dirty the block so DiscardBlock has pages to
+            // drop and nobody gets to skip already-zero pages
+            memset(buf, 1, size);
+            auto start = std::chrono::steady_clock::now();
+            fn(buf, size);
+            asm volatile("" : : "r"(buf) : "memory");
+            elapsed += std::chrono::steady_clock::now() - start;
+        }
+    }
+    return (f64)(reps * size) / elapsed.count() / (f64)Gigabytes(1);
+}
+
+int main()
+{
+    MemoryIndex bigSize = Megabytes(64);
+    u8* buf = static_cast<u8*>(mmap(nullptr, bigSize, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (buf == MAP_FAILED)
+        return 1;
+    memset(buf, 1, bigSize);
+
+    struct { const char* name; MemoryIndex size; MemoryIndex total; bool dirty; } cases[] =
+    {
+        {"64 B", 64, Gigabytes(1), false},
+        {"4 KiB", Kilobytes(4), Gigabytes(4), false},
+        {"64 MiB", Megabytes(64), Gigabytes(1), true},
+    };
+
+    printf("%8s %14s %14s %14s %14s\n", "size", "memset GiB/s", "Zero GiB/s", "Stream GiB/s",
+           "Discard GiB/s");
+    for (auto& c : cases)
+    {
+        printf("%8s %14.2f %14.2f %14.2f %14.2f\n", c.name,
+               RunBench(Memset, buf, c.size, c.total, c.dirty),
+               RunBench(ZeroBlock, buf, c.size, c.total, c.dirty),
+               RunBench(ZeroBlockStreaming, buf, c.size, c.total, c.dirty),
+               RunBench(DiscardBlock, buf, c.size, c.total, c.dirty));
+    }
+    munmap(buf, bigSize);
+    return 0;
+}
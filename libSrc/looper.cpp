@@ -10,6 +10,17 @@
 #include <iostream>
 // Only temporarily
 #include <cstdio>
+#include <cstdlib>
+
+// NOTE(Chris): Offsets and capacities can't change without losing the
+// state, only the layouts of the structs in them
+FileScope const HeapRoot loopRoots[] =
+{
+    {&LayoutOf<GameState>::Get, HeapId::Persistant,
+     PersistantHeapPlan::Offset<0>(), PersistantHeapPlan::ItemSize<0>()},
+    {&LayoutOf<WorkingState>::Get, HeapId::Working,
+     WorkingHeapPlan::Offset<0>(), WorkingHeapPlan::ItemSize<0>()},
+};
 
 FileScope void* Init(CompleteState* state)
 {
@@ -22,16 +33,39 @@ FileScope void AnotherFunc()
 
 FileScope void Close(CompleteState* state)
 {
+#if defined(ARENA_INSTRUMENTATION)
+    MemoryArena* working = GetRegionArena(state, Region_Working);
+    if (working->stats)
+        PrintArenaStats(working->stats, stdout);
+    CloseArenaTrace();
+#endif
 }
 
 FileScope void Reload(CompleteState* state)
 {
     printf("Reloaded!\n");
+    // NOTE(Chris): The heap plans are compiled into the host as well,
+    // this only fails if it's older than the library
+    assert(state->persistantHeapSize >= PersistantHeapPlan::Size()
+           && state->workingHeapSize >= WorkingHeapPlan::Size());
+    // NOTE(Chris): The threads' scratch claims went with the old library
+    WorkingState* workState = GetHeapRoot<WorkingState>(state, loopRoots[1]);
+    if (workState->initialized && workState->scratch.perThreadSize)
+        ReleaseScratchClaims(&workState->scratch);
     // printf("And Again!\n");
+#if defined(ARENA_INSTRUMENTATION)
+    if (const char* tracePath = getenv("LOOP_ARENA_TRACE"))
+        OpenArenaTrace(tracePath);
+#endif
 }
 
 FileScope void Unload(CompleteState* state)
 {
+#if defined(ARENA_INSTRUMENTATION)
+    // NOTE(Chris): The trace lives in this copy of the library, the next
+    // one reopens (and appends to) it
+    CloseArenaTrace();
+#endif
 }
 
 FileScope bool Update(CompleteState* state)
@@ -46,9 +80,10 @@ FileScope bool Update(CompleteState* state)
     AnotherFunc();
     #else
 
-    assert(sizeof(GameState) <= state->persistantHeapSize);
-    GameState* gameState = static_cast<GameState*>(state->persistantHeap);
-    if (!gameState->initialized)
+    GameState* gameState = GetHeapRoot<GameState>(state, loopRoots[0]);
+    // NOTE(Chris): A snapshot restored from another run of the host
+    // brings back window/renderer pointers that mean nothing here
+    if (!gameState->initialized || gameState->sessionId != state->sessionId)
     {
         // TODO(Chris): Move SDL_Init to main
         SDL_Init(SDL_INIT_EVERYTHING);
@@ -61,6 +96,9 @@ FileScope bool Update(CompleteState* state)
             return false;
         }
 
+        if (state->timing.pacing == FramePacing::VSync)
+            SDL_SetHint(SDL_HINT_RENDER_VSYNC, "1");
+
         if (SDL_CreateWindowAndRenderer(displayMode.w / 2, displayMode.h / 2,
                                     SDL_WINDOW_SHOWN,
                                     &gameState->window, &gameState->renderer)
@@ -72,25 +110,43 @@ FileScope bool Update(CompleteState* state)
             return false;
         }
         gameState->initialized = true;
+        gameState->sessionId = state->sessionId;
     }
+    gameState->time += (f32)state->timing.frameSeconds;
 
-    assert(sizeof(WorkingState) <= state->workingHeapSize);
-    WorkingState* workState = static_cast<WorkingState*>(state->workingHeap);
-    if (!workState->initialized)
+    WorkingState* workState = GetHeapRoot<WorkingState>(state, loopRoots[1]);
+    // NOTE(Chris): Everything in the working region hangs off
+    // WorkingState, so if migration reset the scratch arenas start the
+    // region over rather than leak the old ones
+    if (!workState->initialized || workState->scratch.perThreadSize == 0)
     {
-        InitializeArena(&(workState->workingArena), state->workingHeapSize - sizeof(workState),
-                        static_cast<u8*>(state->workingHeap) + sizeof(workState));
+        MemoryArena* working = GetRegionArena(state, Region_Working);
+        ZeroStruct(workState);
+        ResetRegion(state, Region_Working);
+#if defined(ARENA_INSTRUMENTATION)
+        ArenaStats* stats = PushStruct<ArenaStats>(working);
+        InitArenaStats(stats, "working");
+        AttachArenaStats(working, stats);
+#endif
+        MemoryIndex scratchAlignment = state->numaNode >= 0 ? NumaScratchAlignment : 64;
+        InitScratchArenas(&workState->scratch, working, ScratchArenaSize, scratchAlignment);
         workState->initialized = true;
     }
+#if defined(ARENA_INSTRUMENTATION)
+    ArenaTraceFrame(state->timing.frameIndex);
+#endif
+    // NOTE(Chris): Everything pushed to a scratch arena lasts until the
+    // end of the frame it was pushed in
+    ResetScratchArenas(&workState->scratch);
 
 
     // SDL_SetRenderDrawColor(gameState->renderer, 0, 0, 0, 0);
     SDL_RenderClear(gameState->renderer);
     SDL_RenderPresent(gameState->renderer);
 
-    SDL_Event e;
-    while (SDL_PollEvent(&e) != 0)
+    for (u32 i = 0; i < state->input.numEvents; ++i)
     {
+        const SDL_Event& e = state->input.events[i];
         switch (e.type)
         {
         case SDL_QUIT:
@@ -108,4 +164,5 @@ FileScope bool Update(CompleteState* state)
     return true;
 }
 
-const LoopAPI loopAPI = {Init, Close, Reload, Unload, Update};
+const LoopAPI loopAPI = {Init, Close, Reload, Unload, Update,
+                         loopRoots, sizeof(loopRoots) / sizeof(loopRoots[0])};
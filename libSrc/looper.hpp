@@ -24,6 +24,11 @@ struct LoopAPI
 
     /// Update - return true to continue
     bool (*Update)(CompleteState* state);
+
+    /// Structs the library keeps in the heaps, migrated by the host
+    /// before Reload if their layout has changed
+    const HeapRoot* roots;
+    u32 numRoots;
 };
 
 /// The structure of data called from the shared library by the platform code
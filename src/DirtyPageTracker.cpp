@@ -0,0 +1,137 @@
+/* ==========================================================================
+   $File: DirtyPageTracker.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "DirtyPageTracker.hpp"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+
+// NOTE(Chris): See Documentation/admin-guide/mm/soft-dirty.rst
+FileScope constexpr u64 PagemapSoftDirty = 1ULL << 55;
+
+FileScope bool ClearSoftDirty(int clearRefsFd)
+{
+    return pwrite(clearRefsFd, "4", 1, 0) == 1;
+}
+
+FileScope bool ReadPagemap(int pagemapFd, const void* start, MemoryIndex numPages,
+                           MemoryIndex pageSize, u64* entries)
+{
+    MemoryIndex offset = (reinterpret_cast<MemoryIndex>(start) / pageSize) * sizeof(u64);
+    MemoryIndex size = numPages * sizeof(u64);
+    u8* dest = reinterpret_cast<u8*>(entries);
+    while (size > 0)
+    {
+        ssize_t numRead = pread(pagemapFd, dest, size, (off_t)offset);
+        if (numRead <= 0)
+            return false;
+        dest += numRead;
+        offset += numRead;
+        size -= numRead;
+    }
+    return true;
+}
+
+FileScope bool SoftDirtyWorks(int pagemapFd, int clearRefsFd, MemoryIndex pageSize)
+{
+    // NOTE(Chris): The files exist without CONFIG_MEM_SOFT_DIRTY, the
+    // bit just never gets set, so check it on a page of our own
+    void* page = mmap(nullptr, pageSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED)
+        return false;
+
+    *static_cast<volatile u8*>(page) = 1;
+    u64 before = 0, after = 0;
+    bool ok = ClearSoftDirty(clearRefsFd)
+        && ReadPagemap(pagemapFd, page, 1, pageSize, &before);
+    *static_cast<volatile u8*>(page) = 2;
+    ok = ok && ReadPagemap(pagemapFd, page, 1, pageSize, &after);
+
+    munmap(page, pageSize);
+    return ok && !(before & PagemapSoftDirty) && (after & PagemapSoftDirty);
+}
+
+bool InitDirtyPageTracker(DirtyPageTracker* tracker, void* base, MemoryIndex size)
+{
+    *tracker = DirtyPageTracker{};
+    tracker->pagemapFd = -1;
+    tracker->clearRefsFd = -1;
+    tracker->pageSize = (MemoryIndex)sysconf(_SC_PAGESIZE);
+
+    tracker->pagemapFd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    tracker->clearRefsFd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    if (tracker->pagemapFd < 0 || tracker->clearRefsFd < 0
+        || !SoftDirtyWorks(tracker->pagemapFd, tracker->clearRefsFd, tracker->pageSize))
+    {
+        CloseDirtyPageTracker(tracker);
+        return false;
+    }
+
+    tracker->base = static_cast<u8*>(base);
+    tracker->size = size;
+    tracker->numPages = size / tracker->pageSize;
+    tracker->pagemap = static_cast<u64*>(malloc(tracker->numPages * sizeof(u64)));
+    tracker->pageEpoch = static_cast<u32*>(calloc(tracker->numPages, sizeof(u32)));
+    return true;
+}
+
+void CloseDirtyPageTracker(DirtyPageTracker* tracker)
+{
+    if (tracker->pagemapFd >= 0)
+        close(tracker->pagemapFd);
+    if (tracker->clearRefsFd >= 0)
+        close(tracker->clearRefsFd);
+    free(tracker->pagemap);
+    free(tracker->pageEpoch);
+    *tracker = DirtyPageTracker{};
+    tracker->pagemapFd = -1;
+    tracker->clearRefsFd = -1;
+}
+
+bool SampleDirtyPages(DirtyPageTracker* tracker)
+{
+    u32 epoch = ++tracker->epoch;
+    // NOTE(Chris): A write landing between the read and the clear would
+    // be lost, so only sample between frames when nothing else is
+    // touching the heap
+    bool ok = ReadPagemap(tracker->pagemapFd, tracker->base, tracker->numPages,
+                          tracker->pageSize, tracker->pagemap)
+        && ClearSoftDirty(tracker->clearRefsFd);
+    if (!ok)
+    {
+        for (MemoryIndex i = 0; i < tracker->numPages; ++i)
+            tracker->pageEpoch[i] = epoch;
+        return false;
+    }
+
+    for (MemoryIndex i = 0; i < tracker->numPages; ++i)
+    {
+        if (tracker->pagemap[i] & PagemapSoftDirty)
+            tracker->pageEpoch[i] = epoch;
+    }
+    return true;
+}
+
+void MarkPagesDirty(DirtyPageTracker* tracker, const void* start, MemoryIndex size)
+{
+    MemoryIndex first = TrackerPageIndex(tracker, start);
+    MemoryIndex end = first + size / tracker->pageSize;
+    for (MemoryIndex i = first; i < end; ++i)
+        tracker->pageEpoch[i] = tracker->epoch;
+}
+
+MemoryIndex CountDirtyPages(const DirtyPageTracker* tracker, const void* start, MemoryIndex size)
+{
+    MemoryIndex first = TrackerPageIndex(tracker, start);
+    MemoryIndex end = first + size / tracker->pageSize;
+    MemoryIndex count = 0;
+    for (MemoryIndex i = first; i < end; ++i)
+        count += tracker->pageEpoch[i] == tracker->epoch;
+    return count;
+}
@@ -0,0 +1,65 @@
+// -*- c++ -*-
+#if !defined(DIRTYPAGETRACKER_H)
+/* ==========================================================================
+   $File: DirtyPageTracker.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Tracks which pages of the host heap have been written, using the
+   kernel's soft-dirty bits (/proc/self/pagemap, cleared through
+   /proc/self/clear_refs). Each sample stamps the pages written since
+   the previous sample with the new epoch, so any number of consumers
+   (snapshots, per-frame stats) can each ask "what changed since epoch
+   N" without needing their own clear.
+
+   clear_refs is process wide and write-protects every page we own, so
+   sampling isn't free: one 8 byte pagemap read per heap page and a
+   minor fault on the first write to each page afterwards.
+   ========================================================================== */
+
+#define DIRTYPAGETRACKER_H
+#include "LethaniGlobalDefines.h"
+#include "../libSrc/MemoryLayout.hpp"
+
+struct DirtyPageTracker
+{
+    u8* base;
+    MemoryIndex size;
+    MemoryIndex pageSize;
+    MemoryIndex numPages;
+
+    int pagemapFd;
+    int clearRefsFd;
+    /// Scratch for the raw pagemap entries
+    u64* pagemap;
+
+    /// Incremented by each sample, starts at 0
+    u32 epoch;
+    /// Epoch of the last sample that saw each page dirty
+    u32* pageEpoch;
+};
+
+/// Returns false if soft-dirty tracking isn't available (no
+/// CONFIG_MEM_SOFT_DIRTY, or /proc not mounted), leaving tracker unusable
+bool InitDirtyPageTracker(DirtyPageTracker* tracker, void* base, MemoryIndex size);
+void CloseDirtyPageTracker(DirtyPageTracker* tracker);
+/// Stamp every page written since the last sample with a new epoch and
+/// reset the soft-dirty bits. Returns false if pagemap couldn't be read,
+/// in which case every page is stamped. Only call between frames, a
+/// write racing with the sample can be missed.
+bool SampleDirtyPages(DirtyPageTracker* tracker);
+/// Stamp [start, start + size) with the current epoch, for changes the
+/// soft-dirty bits can't see (e.g. a region that has been remapped)
+void MarkPagesDirty(DirtyPageTracker* tracker, const void* start, MemoryIndex size);
+/// Number of pages in [start, start + size) that were dirty in the last sample
+MemoryIndex CountDirtyPages(const DirtyPageTracker* tracker, const void* start, MemoryIndex size);
+/// Index of the page containing ptr
+inline MemoryIndex
+TrackerPageIndex(const DirtyPageTracker* tracker, const void* ptr)
+{
+    return (static_cast<const u8*>(ptr) - tracker->base) / tracker->pageSize;
+}
+
+#endif
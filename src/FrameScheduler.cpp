@@ -0,0 +1,95 @@
+/* ==========================================================================
+   $File: FrameScheduler.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "FrameScheduler.hpp"
+#include <thread>
+
+typedef FrameScheduler::Clock Clock;
+
+FileScope inline f64 Seconds(Clock::duration dur)
+{
+    return std::chrono::duration_cast<std::chrono::duration<f64>>(dur).count();
+}
+
+void InitFrameScheduler(FrameScheduler* sched, FrameTiming* timing,
+                        FramePacing pacing, f64 targetHz)
+{
+    sched->pacing = pacing;
+    sched->targetFrame = Clock::duration::zero();
+    if (pacing == FramePacing::Fixed && targetHz > 0.0)
+    {
+        sched->targetFrame = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<f64>(1.0 / targetHz));
+    }
+    sched->spinMargin = std::chrono::microseconds(1500);
+
+    *timing = FrameTiming{};
+    timing->pacing = pacing;
+    timing->targetSeconds = Seconds(sched->targetFrame);
+
+    ResyncFrameScheduler(sched);
+}
+
+void ResyncFrameScheduler(FrameScheduler* sched)
+{
+    sched->frameStart = Clock::now();
+    sched->updateStart = sched->frameStart;
+    sched->deadline = sched->frameStart;
+}
+
+void BeginUpdate(FrameScheduler* sched)
+{
+    sched->updateStart = Clock::now();
+}
+
+void EndUpdate(FrameScheduler* sched, FrameTiming* timing)
+{
+    timing->updateSeconds = Seconds(Clock::now() - sched->updateStart);
+}
+
+void WaitForNextFrame(FrameScheduler* sched, FrameTiming* timing, LibraryLoader* loader)
+{
+    Clock::time_point now = Clock::now();
+
+    if (sched->pacing == FramePacing::Fixed && sched->targetFrame > Clock::duration::zero())
+    {
+        // NOTE(Chris): Advance the deadline rather than measuring from
+        // now so small oversleeps don't accumulate. If we've overrun,
+        // drop the frame rather than trying to catch up.
+        sched->deadline += sched->targetFrame;
+        if (now >= sched->deadline)
+        {
+            ++timing->missedFrames;
+            sched->deadline = now;
+        }
+        else
+        {
+            Clock::time_point sleepUntil = sched->deadline - sched->spinMargin;
+            if (now < sleepUntil)
+            {
+                WaitForLoadedLibrary(loader, sleepUntil - now);
+                now = Clock::now();
+            }
+
+            if (now < sleepUntil)
+            {
+                // NOTE(Chris): Woken by a newly loaded library, start
+                // the reload frame straight away and pace from there
+                sched->deadline = now;
+            }
+            else
+            {
+                while ((now = Clock::now()) < sched->deadline)
+                    std::this_thread::yield();
+            }
+        }
+    }
+
+    timing->frameSeconds = Seconds(now - sched->frameStart);
+    ++timing->frameIndex;
+    sched->frameStart = now;
+}
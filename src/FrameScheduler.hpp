@@ -0,0 +1,49 @@
+// -*- c++ -*-
+#if !defined(FRAMESCHEDULER_H)
+/* ==========================================================================
+   $File: FrameScheduler.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Paces the host's main loop. Update is timed with the monotonic
+   clock and only the remainder of the frame budget is waited out:
+   the bulk as a sleep (which a newly loaded library can cut short) and the
+   last spinMargin as a spin, as sleep wakeups are too coarse to hit the
+   deadline on their own.
+   ========================================================================== */
+
+#define FRAMESCHEDULER_H
+#include "LethaniGlobalDefines.h"
+#include "../libSrc/MemoryLayout.hpp"
+#include "LibraryLoader.hpp"
+#include <chrono>
+
+struct FrameScheduler
+{
+    typedef std::chrono::steady_clock Clock;
+
+    FramePacing pacing;
+    Clock::duration targetFrame;
+    /// How long before the deadline we stop sleeping and start spinning
+    Clock::duration spinMargin;
+
+    Clock::time_point frameStart;
+    Clock::time_point updateStart;
+    Clock::time_point deadline;
+};
+
+/// targetHz is only used for FramePacing::Fixed
+void InitFrameScheduler(FrameScheduler* sched, FrameTiming* timing,
+                        FramePacing pacing, f64 targetHz);
+/// Restart the frame clock, e.g. after time spent without a library loaded
+void ResyncFrameScheduler(FrameScheduler* sched);
+/// Call immediately before Update
+void BeginUpdate(FrameScheduler* sched);
+/// Call immediately after Update, records its cost into timing
+void EndUpdate(FrameScheduler* sched, FrameTiming* timing);
+/// Wait out the rest of the frame and advance the frame counters
+void WaitForNextFrame(FrameScheduler* sched, FrameTiming* timing, LibraryLoader* loader);
+
+#endif
@@ -0,0 +1,247 @@
+/* ==========================================================================
+   $File: HeapSnapshot.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "HeapSnapshot.hpp"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <vector>
+
+FileScope constexpr u64 SnapshotMagic = 0x544F4E5350414548ULL; // "HEAPSNOT"
+FileScope constexpr u32 SnapshotVersion = 1;
+
+FileScope inline MemoryIndex AlignUp(MemoryIndex value, MemoryIndex alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+FileScope inline u64 RotateLeft(u64 value, u32 shift)
+{
+    return (value << shift) | (value >> (64 - shift));
+}
+
+FileScope u64 HashPage(const u8* page, MemoryIndex size)
+{
+    // NOTE(Chris): Four independent lanes so we're limited by memory
+    // bandwidth rather than multiply latency. Not cryptographic, just
+    // needs to notice a page changing.
+    const u64 prime = 0x9E3779B97F4A7C15ULL;
+    const u64* words = reinterpret_cast<const u64*>(page);
+    MemoryIndex numWords = size / sizeof(u64);
+    u64 a = prime, b = prime ^ 1, c = prime ^ 2, d = prime ^ 3;
+    for (MemoryIndex i = 0; i < numWords; i += 4)
+    {
+        a = RotateLeft(a + words[i] * prime, 31) * prime;
+        b = RotateLeft(b + words[i + 1] * prime, 31) * prime;
+        c = RotateLeft(c + words[i + 2] * prime, 31) * prime;
+        d = RotateLeft(d + words[i + 3] * prime, 31) * prime;
+    }
+    u64 hash = RotateLeft(a, 1) + RotateLeft(b, 7) + RotateLeft(c, 12) + RotateLeft(d, 18);
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+FileScope bool WriteAll(int fd, const void* data, MemoryIndex size, MemoryIndex offset)
+{
+    const u8* bytes = static_cast<const u8*>(data);
+    while (size > 0)
+    {
+        ssize_t written = pwrite(fd, bytes, size, (off_t)offset);
+        if (written <= 0)
+            return false;
+        bytes += written;
+        offset += written;
+        size -= written;
+    }
+    return true;
+}
+
+FileScope bool ReadAll(int fd, void* data, MemoryIndex size, MemoryIndex offset)
+{
+    u8* bytes = static_cast<u8*>(data);
+    while (size > 0)
+    {
+        ssize_t numRead = pread(fd, bytes, size, (off_t)offset);
+        if (numRead <= 0)
+            return false;
+        bytes += numRead;
+        offset += numRead;
+        size -= numRead;
+    }
+    return true;
+}
+
+FileScope bool WriteIndex(HeapSnapshot* snap)
+{
+    return WriteAll(snap->fd, snap->pageHashes, snap->numPages * sizeof(u64), snap->hashOffset)
+        && WriteAll(snap->fd, &snap->header, sizeof(snap->header), 0);
+}
+
+bool OpenHeapSnapshot(HeapSnapshot* snap, const char* path, void* heap, MemoryIndex heapSize,
+                      DirtyPageTracker* tracker)
+{
+    *snap = HeapSnapshot{};
+    snap->pageSize = (MemoryIndex)sysconf(_SC_PAGESIZE);
+    // NOTE(Chris): cleanEpoch of 0 means every page the tracker has ever
+    // seen written is a candidate, which is right for a fresh file
+    snap->tracker = tracker;
+    snap->cleanEpoch = 0;
+    assert(heapSize % snap->pageSize == 0);
+
+    snap->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (snap->fd < 0)
+        return false;
+
+    snap->heap = static_cast<u8*>(heap);
+    snap->heapSize = heapSize;
+    snap->numPages = heapSize / snap->pageSize;
+    snap->hashOffset = snap->pageSize;
+    snap->dataOffset = snap->hashOffset + AlignUp(snap->numPages * sizeof(u64), snap->pageSize);
+    snap->pageHashes = static_cast<u64*>(malloc(snap->numPages * sizeof(u64)));
+
+    SnapshotHeader& header = snap->header;
+    if (ReadAll(snap->fd, &header, sizeof(header), 0)
+        && header.magic == SnapshotMagic
+        && header.version == SnapshotVersion
+        && header.pageSize == snap->pageSize
+        && header.heapSize == heapSize
+        && ReadAll(snap->fd, snap->pageHashes, snap->numPages * sizeof(u64), snap->hashOffset))
+    {
+        return true;
+    }
+
+    // NOTE(Chris): New (or incompatible) file. The data section is
+    // sparse, i.e. zero, so every page starts with the zero page hash
+    // and the first save only writes pages that have been used
+    header = SnapshotHeader{};
+    header.magic = SnapshotMagic;
+    header.version = SnapshotVersion;
+    header.pageSize = (u32)snap->pageSize;
+    header.heapBase = reinterpret_cast<u64>(heap);
+    header.heapSize = heapSize;
+
+    std::vector<u8> zeroPage(snap->pageSize, 0);
+    u64 zeroHash = HashPage(zeroPage.data(), snap->pageSize);
+    for (MemoryIndex i = 0; i < snap->numPages; ++i)
+        snap->pageHashes[i] = zeroHash;
+
+    if (ftruncate(snap->fd, 0) != 0
+        || ftruncate(snap->fd, (off_t)(snap->dataOffset + heapSize)) != 0
+        || !WriteIndex(snap))
+    {
+        CloseHeapSnapshot(snap);
+        return false;
+    }
+    return true;
+}
+
+void CloseHeapSnapshot(HeapSnapshot* snap)
+{
+    if (snap->fd >= 0)
+        close(snap->fd);
+    free(snap->pageHashes);
+    *snap = HeapSnapshot{};
+    snap->fd = -1;
+}
+
+bool SaveHeapSnapshot(HeapSnapshot* snap, MemoryIndex* pagesWritten)
+{
+    MemoryIndex written = 0;
+    MemoryIndex runStart = 0;
+    MemoryIndex runLength = 0;
+    bool ok = true;
+
+    DirtyPageTracker* tracker = snap->tracker;
+    MemoryIndex trackerFirst = 0;
+    if (tracker)
+    {
+        SampleDirtyPages(tracker);
+        trackerFirst = TrackerPageIndex(tracker, snap->heap);
+    }
+
+    // NOTE(Chris): Coalesce runs of changed pages into a single write
+    for (MemoryIndex i = 0; i <= snap->numPages && ok; ++i)
+    {
+        bool changed = false;
+        bool candidate = i < snap->numPages
+            && (!tracker || tracker->pageEpoch[trackerFirst + i] > snap->cleanEpoch);
+        if (candidate)
+        {
+            u64 hash = HashPage(snap->heap + i * snap->pageSize, snap->pageSize);
+            changed = hash != snap->pageHashes[i];
+            snap->pageHashes[i] = hash;
+        }
+
+        if (changed)
+        {
+            if (runLength == 0)
+                runStart = i;
+            ++runLength;
+        }
+        else if (runLength > 0)
+        {
+            ok = WriteAll(snap->fd, snap->heap + runStart * snap->pageSize,
+                          runLength * snap->pageSize,
+                          snap->dataOffset + runStart * snap->pageSize);
+            written += runLength;
+            runLength = 0;
+        }
+    }
+
+    if (!ok)
+    {
+        // NOTE(Chris): The table no longer matches the file, force the
+        // next open to start again
+        snap->header.saveCount = 0;
+        WriteAll(snap->fd, &snap->header, sizeof(snap->header), 0);
+        return false;
+    }
+
+    if (tracker)
+        snap->cleanEpoch = tracker->epoch;
+    snap->header.heapBase = reinterpret_cast<u64>(snap->heap);
+    ++snap->header.saveCount;
+    if (pagesWritten)
+        *pagesWritten = written;
+    return WriteIndex(snap);
+}
+
+bool CanRestoreHeapSnapshot(const HeapSnapshot* snap)
+{
+    return snap->fd >= 0
+        && snap->header.saveCount > 0
+        && snap->header.heapBase == reinterpret_cast<u64>(snap->heap);
+}
+
+bool RestoreHeapSnapshot(HeapSnapshot* snap)
+{
+    if (!CanRestoreHeapSnapshot(snap))
+        return false;
+
+    // NOTE(Chris): MAP_FIXED is fine here, we're deliberately replacing
+    // our own heap pages. Unmodified pages stay shared with the page
+    // cache, and as the file is only ever written from pages we've
+    // dirtied (which are then private copies) they never change under us.
+    void* mem = mmap(snap->heap, snap->heapSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_FIXED, snap->fd, (off_t)snap->dataOffset);
+    if (mem != snap->heap)
+        return false;
+
+    // NOTE(Chris): The whole heap has changed as far as every other
+    // snapshot is concerned, but we know it matches this one. Sampling
+    // also clears the soft-dirty flag the kernel puts on new mappings.
+    if (snap->tracker)
+    {
+        SampleDirtyPages(snap->tracker);
+        MarkPagesDirty(snap->tracker, snap->heap, snap->heapSize);
+        snap->cleanEpoch = snap->tracker->epoch;
+    }
+    return true;
+}
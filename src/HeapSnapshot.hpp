@@ -0,0 +1,75 @@
+// -*- c++ -*-
+#if !defined(HEAPSNAPSHOT_H)
+/* ==========================================================================
+   $File: HeapSnapshot.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Save states of the persistent heap. The snapshot file holds a
+   header page, a table of per-page hashes and then the heap itself,
+   page aligned. Saving hashes each heap page and only writes the ones
+   that differ from what's in the file, restoring maps the file
+   copy-on-write over the heap, so neither is a full 128 MiB copy.
+   Given a DirtyPageTracker only pages written since the last save or
+   restore are even hashed.
+
+   File layout:
+     [SnapshotHeader, padded to a page]
+     [u64 hash per heap page, padded to a page]
+     [heap pages]
+   ========================================================================== */
+
+#define HEAPSNAPSHOT_H
+#include "LethaniGlobalDefines.h"
+#include "../libSrc/MemoryLayout.hpp"
+#include "DirtyPageTracker.hpp"
+
+struct SnapshotHeader
+{
+    u64 magic;
+    u32 version;
+    u32 pageSize;
+    /// Address the heap lived at, pointers inside it are only valid there
+    u64 heapBase;
+    u64 heapSize;
+    /// Zero until the first complete save
+    u64 saveCount;
+};
+
+struct HeapSnapshot
+{
+    int fd;
+    u8* heap;
+    MemoryIndex heapSize;
+    MemoryIndex pageSize;
+    MemoryIndex numPages;
+    /// Hash of each page as it currently is in the file
+    u64* pageHashes;
+    /// Offsets of the hash table and page data in the file
+    MemoryIndex hashOffset;
+    MemoryIndex dataOffset;
+    SnapshotHeader header;
+
+    /// Optional, must cover the heap
+    DirtyPageTracker* tracker;
+    /// Tracker epoch at which the heap last matched the file
+    u32 cleanEpoch;
+};
+
+/// Open (creating if needed) the snapshot file for heap. An existing
+/// file is kept if it was written for the same heap size.
+bool OpenHeapSnapshot(HeapSnapshot* snap, const char* path, void* heap, MemoryIndex heapSize,
+                      DirtyPageTracker* tracker = nullptr);
+void CloseHeapSnapshot(HeapSnapshot* snap);
+/// Write the pages of the heap that changed since the file was last
+/// written. pagesWritten may be null.
+bool SaveHeapSnapshot(HeapSnapshot* snap, MemoryIndex* pagesWritten);
+/// Whether the file holds a complete snapshot that can be restored here
+bool CanRestoreHeapSnapshot(const HeapSnapshot* snap);
+/// Replace the heap contents with the snapshot. Pages are mapped
+/// copy-on-write from the file, so this is O(1) until they're touched.
+bool RestoreHeapSnapshot(HeapSnapshot* snap);
+
+#endif
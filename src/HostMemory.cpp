@@ -0,0 +1,290 @@
+/* ==========================================================================
+   $File: HostMemory.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "HostMemory.hpp"
+#include <sys/mman.h>
+#include <cstdio>
+#include <cstring>
+#include <cinttypes>
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+// NOTE(Chris): The x86-64 default, used for alignment only
+FileScope constexpr MemoryIndex HugePageSize = Megabytes(2);
+
+FileScope inline MemoryIndex AlignUp(MemoryIndex value, MemoryIndex alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+FileScope void* MapAnonymous(void* fixedBase, MemoryIndex size, int flags)
+{
+    flags |= MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_FIXED_NOREPLACE
+    if (fixedBase)
+        flags |= MAP_FIXED_NOREPLACE;
+#endif
+
+    void* mem = mmap(fixedBase, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mem == MAP_FAILED)
+        return nullptr;
+
+    // NOTE(Chris): Kernels older than 4.17 treat MAP_FIXED_NOREPLACE (or
+    // its absence) as a hint, so check we really got the address.
+    // Never use MAP_FIXED, it would silently replace whatever is there
+    if (fixedBase && mem != fixedBase)
+    {
+        munmap(mem, size);
+        return nullptr;
+    }
+    return mem;
+}
+
+bool AllocateHostHeap(HostHeap* heap, MemoryIndex size, HeapPages pages, void* fixedBase)
+{
+    *heap = HostHeap{};
+    size = AlignUp(size, HugePageSize);
+
+    if (fixedBase && (reinterpret_cast<MemoryIndex>(fixedBase) & (HugePageSize - 1)))
+        return false;
+
+#ifdef MAP_HUGETLB
+    if (pages == HeapPages::HugeTLB)
+    {
+        // NOTE(Chris): No MAP_NORESERVE here, we want the mmap to fail
+        // if the pool is too small rather than SIGBUS on first touch
+        void* mem = MapAnonymous(fixedBase, size, MAP_HUGETLB);
+        if (mem)
+        {
+            heap->base = heap->mapping = mem;
+            heap->size = heap->mappingSize = size;
+            heap->pages = HeapPages::HugeTLB;
+            heap->fixed = fixedBase != nullptr;
+            return true;
+        }
+        pages = HeapPages::Transparent;
+    }
+#else
+    if (pages == HeapPages::HugeTLB)
+        pages = HeapPages::Transparent;
+#endif
+
+    u8* base = nullptr;
+    if (fixedBase)
+    {
+        base = static_cast<u8*>(MapAnonymous(fixedBase, size, MAP_NORESERVE));
+        if (!base)
+            return false;
+    }
+    else
+    {
+        // NOTE(Chris): Over-reserve so the heap can start on a huge page
+        // boundary, otherwise THP can't back the first and last 2 MiB
+        MemoryIndex mappingSize = size + HugePageSize;
+        u8* start = static_cast<u8*>(MapAnonymous(nullptr, mappingSize, MAP_NORESERVE));
+        if (!start)
+            return false;
+
+        base = reinterpret_cast<u8*>(AlignUp(reinterpret_cast<MemoryIndex>(start), HugePageSize));
+        MemoryIndex head = base - start;
+        MemoryIndex tail = mappingSize - head - size;
+        if (head)
+            munmap(start, head);
+        if (tail)
+            munmap(base + size, tail);
+    }
+
+    heap->base = heap->mapping = base;
+    heap->size = heap->mappingSize = size;
+    heap->pages = HeapPages::Normal;
+    heap->fixed = fixedBase != nullptr;
+
+#ifdef MADV_HUGEPAGE
+    if (pages == HeapPages::Transparent && madvise(base, size, MADV_HUGEPAGE) == 0)
+        heap->pages = HeapPages::Transparent;
+#endif
+    return true;
+}
+
+void AdviseHostHeap(const HostHeap* heap, void* base, MemoryIndex size)
+{
+#ifdef MADV_HUGEPAGE
+    if (heap->pages == HeapPages::Transparent)
+        madvise(base, size, MADV_HUGEPAGE);
+#else
+    (void)heap;
+    (void)base;
+    (void)size;
+#endif
+}
+
+void FreeHostHeap(HostHeap* heap)
+{
+    if (heap->mapping)
+        munmap(heap->mapping, heap->mappingSize);
+    *heap = HostHeap{};
+}
+
+HostHeapStats QueryHostHeapStats(const HostHeap* heap)
+{
+    HostHeapStats stats{};
+    stats.reserved = heap->size;
+
+    FILE* smaps = fopen("/proc/self/smaps", "r");
+    if (!smaps)
+        return stats;
+
+    MemoryIndex heapStart = reinterpret_cast<MemoryIndex>(heap->base);
+    MemoryIndex heapEnd = heapStart + heap->size;
+    bool inHeap = false;
+    char line[512];
+    while (fgets(line, sizeof(line), smaps))
+    {
+        uintmax_t start, end;
+        if (sscanf(line, "%" SCNxMAX "-%" SCNxMAX " ", &start, &end) == 2)
+        {
+            // NOTE(Chris): The kernel may split our mapping into several
+            // VMAs (e.g. after madvise or mprotect), count all of them
+            inHeap = start >= heapStart && end <= heapEnd;
+            continue;
+        }
+        if (!inHeap)
+            continue;
+
+        uintmax_t kb;
+        if (sscanf(line, "Rss: %" SCNuMAX " kB", &kb) == 1)
+            stats.resident += Kilobytes(kb);
+        else if (sscanf(line, "AnonHugePages: %" SCNuMAX " kB", &kb) == 1)
+            stats.hugePageBytes += Kilobytes(kb);
+        else if (sscanf(line, "Private_Hugetlb: %" SCNuMAX " kB", &kb) == 1)
+            stats.hugePageBytes += Kilobytes(kb);
+    }
+    fclose(smaps);
+
+    // NOTE(Chris): hugetlb pages don't show up in Rss
+    if (heap->pages == HeapPages::HugeTLB)
+        stats.resident += stats.hugePageBytes;
+
+    return stats;
+}
+
+const char* HeapPagesName(HeapPages pages)
+{
+    switch (pages)
+    {
+    case HeapPages::Normal:
+        return "normal";
+    case HeapPages::Transparent:
+        return "thp";
+    case HeapPages::HugeTLB:
+        return "hugetlb";
+    }
+    return "unknown";
+}
+
+i32 CurrentNumaNode()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return (i32)node;
+#endif
+    return 0;
+}
+
+bool PinThreadToNumaNode(i32 node)
+{
+#ifdef __linux__
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return false;
+
+    // NOTE(Chris): e.g. "0-7,16-23"
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    int first, last;
+    while (fscanf(file, "%d", &first) == 1)
+    {
+        last = first;
+        if (fscanf(file, "-%d", &last) != 1)
+            last = first;
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET(cpu, &cpus);
+        if (fgetc(file) != ',')
+            break;
+    }
+    fclose(file);
+
+    return CPU_COUNT(&cpus) > 0 && sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+#else
+    return false;
+#endif
+}
+
+bool BindMemoryToNumaNode(void* base, MemoryIndex size, i32 node)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    unsigned long nodeMask = 0;
+    if (node < 0 || node >= (i32)(sizeof(nodeMask) * 8))
+        return false;
+    nodeMask = 1UL << node;
+
+    // NOTE(Chris): Preferred rather than bind, so running out of memory
+    // on the node spills elsewhere instead of killing us. The kernel
+    // drops the last bit of maxnode, hence the + 1
+    return syscall(SYS_mbind, base, size, MPOL_PREFERRED, &nodeMask,
+                   sizeof(nodeMask) * 8 + 1, 0) == 0;
+#else
+    return false;
+#endif
+}
+
+HostNumaStats QueryHostNumaStats(const void* base, MemoryIndex size, i32 localNode)
+{
+    HostNumaStats stats{};
+
+    FILE* numaMaps = fopen("/proc/self/numa_maps", "r");
+    if (!numaMaps)
+        return stats;
+
+    MemoryIndex rangeStart = reinterpret_cast<MemoryIndex>(base);
+    MemoryIndex rangeEnd = rangeStart + size;
+    // NOTE(Chris): Lines can be long (file names), but the page counts
+    // come after them, so read whole lines
+    char line[4096];
+    while (fgets(line, sizeof(line), numaMaps))
+    {
+        // NOTE(Chris): e.g. "7f0000000000 prefer:0 anon=512 dirty=512 N0=512 kernelpagesize_kB=4"
+        uintmax_t start;
+        if (sscanf(line, "%" SCNxMAX, &start) != 1 || start < rangeStart || start >= rangeEnd)
+            continue;
+
+        uintmax_t pageKb = 4;
+        if (const char* pageSize = strstr(line, "kernelpagesize_kB="))
+            sscanf(pageSize, "kernelpagesize_kB=%" SCNuMAX, &pageKb);
+
+        for (const char* token = strstr(line, " N"); token; token = strstr(token + 1, " N"))
+        {
+            int node;
+            uintmax_t pages;
+            if (sscanf(token, " N%d=%" SCNuMAX, &node, &pages) != 2)
+                continue;
+            if (node == localNode)
+                stats.localBytes += Kilobytes(pages * pageKb);
+            else
+                stats.remoteBytes += Kilobytes(pages * pageKb);
+        }
+    }
+    fclose(numaMaps);
+    return stats;
+}
@@ -0,0 +1,95 @@
+// -*- c++ -*-
+#if !defined(HOSTMEMORY_H)
+/* ==========================================================================
+   $File: HostMemory.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Backing memory for the CompleteState heaps. The heaps are reserved
+   with an anonymous mmap, so they are zeroed and faulted in lazily by
+   the kernel rather than memset up front, and can optionally be backed
+   by huge pages to cut TLB misses on arena-heavy frames.
+
+   The heap can also be placed at a fixed virtual address, so that
+   pointers stored in it (e.g. from a snapshot of the persistent heap)
+   stay valid in a later process without any fix-ups.
+
+   On NUMA machines a range of the heap can be bound to the node of the
+   thread that uses it, before anything touches it. Anything unbound is
+   placed by the kernel on first touch, on the node of the touching thread.
+   ========================================================================== */
+
+#define HOSTMEMORY_H
+#include "LethaniGlobalDefines.h"
+#include "../libSrc/MemoryLayout.hpp"
+
+enum class HeapPages
+{
+    /// Plain 4 KiB pages
+    Normal,
+    /// madvise(MADV_HUGEPAGE), the kernel promotes to 2 MiB pages as it can
+    Transparent,
+    /// MAP_HUGETLB from the reserved pool, falls back to Transparent
+    HugeTLB,
+};
+
+struct HostHeap
+{
+    void* base;
+    MemoryIndex size;
+    /// What we actually got, may differ from what was asked for
+    HeapPages pages;
+    /// Whether base is the fixed address that was requested
+    bool fixed;
+    /// Start and length of the whole mapping, including alignment slack
+    void* mapping;
+    MemoryIndex mappingSize;
+};
+
+struct HostHeapStats
+{
+    MemoryIndex reserved;
+    /// Bytes that have been faulted in
+    MemoryIndex resident;
+    /// Resident bytes backed by huge pages (THP or hugetlbfs)
+    MemoryIndex hugePageBytes;
+};
+
+struct HostNumaStats
+{
+    /// Resident bytes on the node asked about, and on any other node
+    MemoryIndex localBytes;
+    MemoryIndex remoteBytes;
+};
+
+/// Default address for fixed heaps, well clear of where the loader and
+/// malloc put things on x86-64 Linux
+FileScope constexpr MemoryIndex DefaultFixedHeapBase = Terabytes(2);
+
+/// Reserve size bytes of zeroed memory, returns false on failure. If
+/// fixedBase is given (must be 2 MiB aligned) the heap is placed exactly
+/// there, failing rather than clobbering an existing mapping.
+bool AllocateHostHeap(HostHeap* heap, MemoryIndex size, HeapPages pages,
+                      void* fixedBase = nullptr);
+void FreeHostHeap(HostHeap* heap);
+/// Advise the range (part of heap) again the way AllocateHostHeap did,
+/// for after something has been mapped over it
+void AdviseHostHeap(const HostHeap* heap, void* base, MemoryIndex size);
+/// Parses /proc/self/smaps, so not for calling every frame
+HostHeapStats QueryHostHeapStats(const HostHeap* heap);
+const char* HeapPagesName(HeapPages pages);
+
+/// NUMA node of the CPU the calling thread is on, 0 if unknown
+i32 CurrentNumaNode();
+/// Keep the calling thread on the CPUs of node, so memory bound to that
+/// node stays local to it
+bool PinThreadToNumaNode(i32 node);
+/// Prefer node for every page of the range not yet faulted in. Returns
+/// false if the kernel doesn't support NUMA policies.
+bool BindMemoryToNumaNode(void* base, MemoryIndex size, i32 node);
+/// Where the resident pages of the range are, from /proc/self/numa_maps
+HostNumaStats QueryHostNumaStats(const void* base, MemoryIndex size, i32 localNode);
+
+#endif
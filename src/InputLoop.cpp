@@ -0,0 +1,118 @@
+/* ==========================================================================
+   $File: InputLoop.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "InputLoop.hpp"
+#include <cstdlib>
+
+struct RecordedFrame
+{
+    f64 frameSeconds;
+    u32 numEvents;
+    u32 pad;
+    // SDL_Event events[numEvents] follow
+};
+
+void InitInputLoop(InputLoop* loop, const char* snapshotPath, MemoryIndex capacity,
+                   DirtyPageTracker* tracker)
+{
+    loop->mode = InputLoopMode::Idle;
+    loop->buffer = static_cast<u8*>(malloc(capacity));
+    loop->capacity = loop->buffer ? capacity : 0;
+    loop->recordPoint = 0;
+    loop->playPoint = 0;
+    loop->numFrames = 0;
+    loop->snapshotPath = std::string(snapshotPath) + ".loop";
+    loop->snapshot = HeapSnapshot{};
+    loop->snapshot.fd = -1;
+    loop->tracker = tracker;
+}
+
+void CloseInputLoop(InputLoop* loop)
+{
+    CloseHeapSnapshot(&loop->snapshot);
+    free(loop->buffer);
+    loop->buffer = nullptr;
+    loop->capacity = 0;
+    loop->mode = InputLoopMode::Idle;
+}
+
+bool BeginInputRecording(InputLoop* loop, void* heap, MemoryIndex heapSize)
+{
+    if (loop->snapshot.fd < 0
+        && !OpenHeapSnapshot(&loop->snapshot, loop->snapshotPath.c_str(), heap, heapSize,
+                             loop->tracker))
+        return false;
+
+    if (!SaveHeapSnapshot(&loop->snapshot, nullptr))
+        return false;
+
+    loop->recordPoint = 0;
+    loop->playPoint = 0;
+    loop->numFrames = 0;
+    loop->mode = InputLoopMode::Recording;
+    return true;
+}
+
+bool RecordInputFrame(InputLoop* loop, const FrameInput* input, f64 frameSeconds)
+{
+    MemoryIndex eventBytes = input->numEvents * sizeof(SDL_Event);
+    if (loop->recordPoint + sizeof(RecordedFrame) + eventBytes > loop->capacity)
+        return false;
+
+    RecordedFrame frame{};
+    frame.frameSeconds = frameSeconds;
+    frame.numEvents = input->numEvents;
+    CopyStruct(reinterpret_cast<RecordedFrame*>(loop->buffer + loop->recordPoint), &frame);
+    loop->recordPoint += sizeof(RecordedFrame);
+
+    CopyBlock(loop->buffer + loop->recordPoint, input->events, eventBytes);
+    loop->recordPoint += eventBytes;
+    ++loop->numFrames;
+    return true;
+}
+
+bool BeginInputPlayback(InputLoop* loop)
+{
+    if (loop->numFrames == 0 || !RestoreHeapSnapshot(&loop->snapshot))
+    {
+        loop->mode = InputLoopMode::Idle;
+        return false;
+    }
+
+    loop->playPoint = 0;
+    loop->mode = InputLoopMode::Playing;
+    return true;
+}
+
+bool PlaybackInputFrame(InputLoop* loop, FrameInput* input, f64* frameSeconds)
+{
+    bool restored = false;
+    if (loop->playPoint >= loop->recordPoint)
+    {
+        // NOTE(Chris): Back to the start of the loop, heap and all
+        if (!BeginInputPlayback(loop))
+            return false;
+        restored = true;
+    }
+
+    RecordedFrame frame;
+    CopyStruct(&frame, reinterpret_cast<const RecordedFrame*>(loop->buffer + loop->playPoint));
+    loop->playPoint += sizeof(RecordedFrame);
+
+    MemoryIndex eventBytes = frame.numEvents * sizeof(SDL_Event);
+    CopyBlock(input->events, loop->buffer + loop->playPoint, eventBytes);
+    input->numEvents = frame.numEvents;
+    loop->playPoint += eventBytes;
+
+    *frameSeconds = frame.frameSeconds;
+    return restored;
+}
+
+void StopInputLoop(InputLoop* loop)
+{
+    loop->mode = InputLoopMode::Idle;
+}
@@ -0,0 +1,75 @@
+// -*- c++ -*-
+#if !defined(INPUTLOOP_H)
+/* ==========================================================================
+   $File: InputLoop.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Live looping: record the input for a run of frames along with a
+   snapshot of the persistent heap at the start, then play it back
+   forever, restoring the snapshot each time round. Combined with hot
+   reloading this lets the code be iterated on against the same input
+   with nobody at the keyboard.
+
+   Frames are stored back to back in a fixed buffer as a small header
+   followed by only the events that frame actually had, so idle frames
+   cost 16 bytes. The frame time is recorded too, as Update integrates
+   it and playback needs to be deterministic.
+
+   The buffer is linear rather than a ring: a loop has to start from
+   the heap snapshot, so old frames can't be dropped to make room
+   without a new snapshot to go with them. When the buffer fills
+   RecordInputFrame refuses the frame and the host starts playing back
+   what was recorded (16 MiB holds about 4.5 hours of idle frames at
+   60 Hz, or 230k frames of one event each).
+   ========================================================================== */
+
+#define INPUTLOOP_H
+#include "LethaniGlobalDefines.h"
+#include "../libSrc/MemoryLayout.hpp"
+#include "HeapSnapshot.hpp"
+#include <string>
+
+enum class InputLoopMode
+{
+    Idle,
+    Recording,
+    Playing,
+};
+
+struct InputLoop
+{
+    InputLoopMode mode;
+    u8* buffer;
+    MemoryIndex capacity;
+    /// End of the recorded frames
+    MemoryIndex recordPoint;
+    /// Next frame to play back
+    MemoryIndex playPoint;
+    u32 numFrames;
+
+    std::string snapshotPath;
+    /// Heap at the start of the recording, opened on first use
+    HeapSnapshot snapshot;
+    /// Optional, passed on to the snapshot
+    DirtyPageTracker* tracker;
+};
+
+void InitInputLoop(InputLoop* loop, const char* snapshotPath, MemoryIndex capacity,
+                   DirtyPageTracker* tracker = nullptr);
+void CloseInputLoop(InputLoop* loop);
+/// Snapshot the heap and start recording from the next frame
+bool BeginInputRecording(InputLoop* loop, void* heap, MemoryIndex heapSize);
+/// Append a frame, returns false (and records nothing) once the buffer is full
+bool RecordInputFrame(InputLoop* loop, const FrameInput* input, f64 frameSeconds);
+/// Restore the starting snapshot and play from the first recorded frame
+bool BeginInputPlayback(InputLoop* loop);
+/// Replace input and frameSeconds with the next recorded frame, looping
+/// (and restoring the heap) at the end of the recording. Returns true if
+/// the heap was restored.
+bool PlaybackInputFrame(InputLoop* loop, FrameInput* input, f64* frameSeconds);
+void StopInputLoop(InputLoop* loop);
+
+#endif
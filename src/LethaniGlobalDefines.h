@@ -27,4 +27,16 @@ typedef unsigned uint;
 // NOTE(Chris): Static defines
 #define FileScope static
 #define LocalPersist static
+
+constexpr u64 HashMixStep(u64 x, u32 shift, u64 mul)
+{
+    return (x ^ (x >> shift)) * mul;
+}
+
+/// splitmix64 finaliser, spreads every input bit over the whole result
+constexpr u64 HashMix(u64 x)
+{
+    return HashMixStep(HashMixStep(x, 30, 0xBF58476D1CE4E5B9ULL), 27, 0x94D049BB133111EBULL)
+        ^ (HashMixStep(HashMixStep(x, 30, 0xBF58476D1CE4E5B9ULL), 27, 0x94D049BB133111EBULL) >> 31);
+}
 #endif
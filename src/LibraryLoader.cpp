@@ -0,0 +1,198 @@
+/* ==========================================================================
+   $File: LibraryLoader.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "LibraryLoader.hpp"
+#include <SDL2/SDL.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <iostream>
+
+// NOTE(Chris): A failed load is retried every watcher timeout (100 ms),
+// as the linker may still have been writing the library. A build that
+// is really broken is given up on after this many attempts
+FileScope constexpr u32 LoadRetries = 20;
+
+FileScope void CloseLoadedLibrary(LibraryLoader* loader, LoadedLibrary* lib)
+{
+    SDL_UnloadObject(lib->handle);
+    // NOTE(Chris): A library with GNU_UNIQUE symbols (not built with
+    // -fno-gnu-unique) is never unmapped, so every reload would leak it
+    if (void* handle = dlopen(lib->path.c_str(), RTLD_LAZY | RTLD_NOLOAD))
+    {
+        std::cout << "Generation " << lib->generation << " of " << loader->libraryPath
+                  << " is still mapped after closing it" << std::endl;
+        dlclose(handle);
+    }
+    if (!loader->shadow.dir.empty())
+        unlink(lib->path.c_str());
+    delete lib;
+}
+
+FileScope void CloseRetiredLibraries(LibraryLoader* loader)
+{
+    LoadedLibrary* lib = loader->retired.exchange(nullptr, std::memory_order_acquire);
+    while (lib)
+    {
+        LoadedLibrary* next = lib->next;
+        CloseLoadedLibrary(loader, lib);
+        lib = next;
+    }
+}
+
+FileScope LoadedLibrary* PrepareLibrary(LibraryLoader* loader)
+{
+    // NOTE(Chris): Duplicate the lib first and only publish once the
+    // copy has loaded and resolved, so a half-written or broken build
+    // just leaves the current generation running while we retry
+    u32 generation = loader->generation + 1;
+    std::string path(loader->libraryPath);
+    if (!loader->shadow.dir.empty())
+    {
+        if (!CreateShadowCopy(&loader->shadow, loader->libraryPath, generation))
+            return nullptr;
+        path = ShadowPath(&loader->shadow, generation);
+    }
+
+    auto discard = [&]()
+    {
+        if (!loader->shadow.dir.empty())
+            unlink(path.c_str());
+    };
+
+    if (!ValidateLibraryFile(path.c_str(), "loopAPI"))
+    {
+        std::cout << "Ignoring incomplete library " << loader->libraryPath << std::endl;
+        discard();
+        return nullptr;
+    }
+
+    void* handle = SDL_LoadObject(path.c_str());
+    if (handle == nullptr)
+    {
+        std::cout << SDL_GetError() << std::endl;
+        discard();
+        return nullptr;
+    }
+
+    auto* api = reinterpret_cast<const LoopAPI*>(SDL_LoadFunction(handle, "loopAPI"));
+    if (api == nullptr)
+    {
+        std::cout << SDL_GetError() << std::endl;
+        SDL_UnloadObject(handle);
+        discard();
+        return nullptr;
+    }
+
+    loader->generation = generation;
+    LoadedLibrary* lib = new LoadedLibrary;
+    lib->handle = handle;
+    lib->api = *api;
+    lib->generation = generation;
+    lib->path = path;
+    lib->next = nullptr;
+    return lib;
+}
+
+FileScope void LoaderThread(LibraryLoader* loader)
+{
+    while (!loader->stop.load(std::memory_order_acquire))
+    {
+        WaitForLibraryChange(&loader->watcher, std::chrono::milliseconds(100));
+        CloseRetiredLibraries(loader);
+
+        if (loader->stop.load(std::memory_order_acquire))
+            continue;
+
+        if (LibraryChanged(&loader->watcher))
+            loader->retries = LoadRetries;
+        else if (loader->retries == 0)
+            continue;
+
+        LoadedLibrary* lib = PrepareLibrary(loader);
+        if (lib == nullptr)
+        {
+            if (--loader->retries == 0)
+                std::cout << "Giving up on " << loader->libraryPath
+                          << " until it's rebuilt" << std::endl;
+            continue;
+        }
+        loader->retries = 0;
+
+        // NOTE(Chris): If the main thread never took the previous
+        // generation it's ours to close
+        LoadedLibrary* stale = loader->ready.exchange(lib, std::memory_order_acq_rel);
+        if (stale)
+            CloseLoadedLibrary(loader, stale);
+
+        {
+            std::lock_guard<std::mutex> lock(loader->readyMutex);
+        }
+        loader->readyWake.notify_all();
+    }
+}
+
+void InitLibraryLoader(LibraryLoader* loader, const char* libraryPath)
+{
+    loader->libraryPath = libraryPath;
+    loader->generation = 0;
+    loader->retries = 0;
+    loader->ready.store(nullptr);
+    loader->retired.store(nullptr);
+    loader->stop.store(false);
+
+    if (!InitLibraryWatcher(&loader->watcher, libraryPath))
+        std::cout << "inotify unavailable, polling " << libraryPath << " instead" << std::endl;
+    if (!InitShadowLibrary(&loader->shadow, libraryPath))
+        std::cout << "Unable to create shadow directory, loading " << libraryPath << " directly" << std::endl;
+
+    loader->thread = std::thread(LoaderThread, loader);
+}
+
+void CloseLibraryLoader(LibraryLoader* loader)
+{
+    loader->stop.store(true, std::memory_order_release);
+    if (loader->thread.joinable())
+        loader->thread.join();
+
+    LoadedLibrary* stale = loader->ready.exchange(nullptr);
+    if (stale)
+        CloseLoadedLibrary(loader, stale);
+    CloseRetiredLibraries(loader);
+
+    CloseShadowLibrary(&loader->shadow);
+    CloseLibraryWatcher(&loader->watcher);
+}
+
+LoadedLibrary* TakeLoadedLibrary(LibraryLoader* loader)
+{
+    // NOTE(Chris): Plain load first so the common case doesn't need
+    // exclusive access to the cache line
+    if (loader->ready.load(std::memory_order_relaxed) == nullptr)
+        return nullptr;
+    return loader->ready.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+void RetireLibrary(LibraryLoader* loader, LoadedLibrary* lib)
+{
+    lib->next = loader->retired.load(std::memory_order_relaxed);
+    while (!loader->retired.compare_exchange_weak(lib->next, lib,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed))
+        ;
+}
+
+void WaitForLoadedLibrary(LibraryLoader* loader, std::chrono::nanoseconds timeout)
+{
+    if (timeout <= std::chrono::nanoseconds::zero())
+        return;
+
+    std::unique_lock<std::mutex> lock(loader->readyMutex);
+    loader->readyWake.wait_for(lock, timeout, [loader]()
+                               {
+                                   return loader->ready.load(std::memory_order_acquire) != nullptr;
+                               });
+}
@@ -0,0 +1,78 @@
+// -*- c++ -*-
+#if !defined(LIBRARYLOADER_H)
+/* ==========================================================================
+   $File: LibraryLoader.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Background loading of the hot-reloaded library. The loader thread
+   waits on the LibraryWatcher, makes and validates the shadow copy,
+   dlopens it and resolves loopAPI, then publishes the result through
+   an atomic pointer. The main thread only has to take the new
+   library, Unload the old one, swap and Reload. Old generations are
+   handed back to the loader thread (through a lock-free stack) so the
+   dlclose also happens off the frame loop.
+   ========================================================================== */
+
+#define LIBRARYLOADER_H
+#include "LethaniGlobalDefines.h"
+#include "../libSrc/looper.hpp"
+#include "LibraryWatcher.hpp"
+#include "ShadowLibrary.hpp"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <string>
+
+struct LoadedLibrary
+{
+    void* handle;
+    LoopAPI api;
+    u32 generation;
+    /// File actually loaded, removed once the library is closed
+    std::string path;
+    /// Link for the retired stack
+    LoadedLibrary* next;
+};
+
+struct LibraryLoader
+{
+    const char* libraryPath;
+    LibraryWatcher watcher;
+    ShadowLibrary shadow;
+    /// Last generation prepared, only touched by the loader thread
+    u32 generation;
+    /// Attempts left at a build that failed to load, only touched by
+    /// the loader thread
+    u32 retries;
+
+    /// Most recently prepared library, waiting for the main thread
+    std::atomic<LoadedLibrary*> ready;
+    /// Stack of libraries the main thread has finished with
+    std::atomic<LoadedLibrary*> retired;
+
+    std::atomic<bool> stop;
+    std::thread thread;
+    std::mutex readyMutex;
+    std::condition_variable readyWake;
+};
+
+/// Start watching libraryPath and loading new versions in the background
+void InitLibraryLoader(LibraryLoader* loader, const char* libraryPath);
+/// Stop the loader thread and close everything it still owns. Any
+/// library taken by the main thread must have been retired first.
+void CloseLibraryLoader(LibraryLoader* loader);
+/// Returns the newest fully loaded library, if there is one we haven't
+/// taken yet. A single atomic exchange, safe to call every frame.
+LoadedLibrary* TakeLoadedLibrary(LibraryLoader* loader);
+/// Hand a library back to the loader thread to be closed. Its Unload or
+/// Close must already have been called.
+void RetireLibrary(LibraryLoader* loader, LoadedLibrary* lib);
+/// Block for up to timeout, returning early once a new library is ready
+void WaitForLoadedLibrary(LibraryLoader* loader, std::chrono::nanoseconds timeout);
+
+#endif
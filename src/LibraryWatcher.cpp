@@ -0,0 +1,174 @@
+/* ==========================================================================
+   $File: LibraryWatcher.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "LibraryWatcher.hpp"
+#include <sys/stat.h>
+#include <string>
+#include <cstring>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <cerrno>
+#endif
+
+FileScope bool PollLibraryMTime(LibraryWatcher* watcher)
+{
+    struct stat libData;
+    if (stat(watcher->path, &libData) != 0)
+        return false;
+
+#ifdef __APPLE__
+    timespec mtime = libData.st_mtimespec;
+#else
+    timespec mtime = libData.st_mtim;
+#endif
+    if (mtime.tv_sec == watcher->updateTime.tv_sec && mtime.tv_nsec == watcher->updateTime.tv_nsec)
+        return false;
+
+    watcher->updateTime = mtime;
+    return true;
+}
+
+#ifdef __linux__
+FileScope void WatchThread(LibraryWatcher* watcher, std::string fileName)
+{
+    // NOTE(Chris): inotify_events are variable length (name is appended),
+    // so read as many as fit and walk the buffer
+    alignas(inotify_event) char buf[4096];
+    pollfd fds[2] = {{watcher->notifyFd, POLLIN, 0}, {watcher->stopPipe[0], POLLIN, 0}};
+
+    while (true)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (fds[1].revents != 0)
+            break;
+
+        if (!(fds[0].revents & POLLIN))
+            continue;
+
+        ssize_t len = read(watcher->notifyFd, buf, sizeof(buf));
+        if (len <= 0)
+            continue;
+
+        bool hit = false;
+        for (char* ptr = buf; ptr < buf + len;)
+        {
+            auto* event = reinterpret_cast<inotify_event*>(ptr);
+            if (event->len > 0 && fileName == event->name)
+                hit = true;
+            ptr += sizeof(inotify_event) + event->len;
+        }
+
+        if (hit)
+        {
+            {
+                std::lock_guard<std::mutex> lock(watcher->wakeMutex);
+                watcher->changed.store(true, std::memory_order_release);
+            }
+            watcher->wake.notify_all();
+        }
+    }
+}
+#endif
+
+bool InitLibraryWatcher(LibraryWatcher* watcher, const char* path)
+{
+    watcher->path = path;
+    watcher->changed.store(true);
+    watcher->notifyFd = -1;
+    watcher->watchFd = -1;
+    watcher->stopPipe[0] = watcher->stopPipe[1] = -1;
+    watcher->updateTime = timespec{};
+
+#ifdef __linux__
+    // NOTE(Chris): Watch the directory rather than the file, the linker
+    // may unlink and recreate the .so, which would orphan a file watch
+    std::string fullPath(path);
+    std::string dir(".");
+    std::string fileName(fullPath);
+    auto slash = fullPath.find_last_of('/');
+    if (slash != std::string::npos)
+    {
+        dir = fullPath.substr(0, slash);
+        fileName = fullPath.substr(slash + 1);
+    }
+
+    watcher->notifyFd = inotify_init1(IN_CLOEXEC);
+    if (watcher->notifyFd < 0)
+        return false;
+
+    watcher->watchFd = inotify_add_watch(watcher->notifyFd, dir.c_str(),
+                                         IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watcher->watchFd < 0 || pipe2(watcher->stopPipe, O_CLOEXEC) != 0)
+    {
+        close(watcher->notifyFd);
+        watcher->notifyFd = -1;
+        watcher->watchFd = -1;
+        return false;
+    }
+
+    watcher->thread = std::thread(WatchThread, watcher, fileName);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CloseLibraryWatcher(LibraryWatcher* watcher)
+{
+#ifdef __linux__
+    if (watcher->notifyFd < 0)
+        return;
+
+    char stop = 1;
+    if (write(watcher->stopPipe[1], &stop, 1) == 1 && watcher->thread.joinable())
+        watcher->thread.join();
+    else if (watcher->thread.joinable())
+        watcher->thread.detach();
+
+    close(watcher->stopPipe[0]);
+    close(watcher->stopPipe[1]);
+    close(watcher->notifyFd);
+    watcher->notifyFd = -1;
+    watcher->watchFd = -1;
+#endif
+}
+
+bool LibraryChanged(LibraryWatcher* watcher)
+{
+    if (watcher->notifyFd < 0)
+        return PollLibraryMTime(watcher);
+
+    // NOTE(Chris): Cheap test first so the common case is a single load
+    if (!watcher->changed.load(std::memory_order_relaxed))
+        return false;
+    return watcher->changed.exchange(false, std::memory_order_acq_rel);
+}
+
+void WaitForLibraryChange(LibraryWatcher* watcher, std::chrono::nanoseconds timeout)
+{
+    if (timeout <= std::chrono::nanoseconds::zero())
+        return;
+
+    if (watcher->notifyFd < 0)
+    {
+        std::this_thread::sleep_for(timeout);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(watcher->wakeMutex);
+    watcher->wake.wait_for(lock, timeout,
+                           [watcher]() { return watcher->changed.load(std::memory_order_acquire); });
+}
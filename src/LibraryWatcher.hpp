@@ -0,0 +1,57 @@
+// -*- c++ -*-
+#if !defined(LIBRARYWATCHER_H)
+/* ==========================================================================
+   $File: LibraryWatcher.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Watches the hot-reloadable library for changes. On Linux this uses
+   inotify on the library's directory from a background thread, so
+   checking for a change is just an atomic load and a waiter can be
+   woken as soon as the linker closes the file. Elsewhere (or if
+   inotify is unavailable) we fall back to polling st_mtime.
+   ========================================================================== */
+
+#define LIBRARYWATCHER_H
+#include "LethaniGlobalDefines.h"
+#include <ctime>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+struct LibraryWatcher
+{
+    const char* path;
+    /// Set by the watch thread, cleared by LibraryChanged
+    std::atomic<bool> changed;
+
+    /// inotify descriptors, -1 if using the stat fallback
+    int notifyFd;
+    int watchFd;
+    /// Write end is poked to shut down the watch thread
+    int stopPipe[2];
+    std::thread thread;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+
+    /// Used by the stat fallback only. Full resolution, as a build
+    /// finishing in the same second it started must still be seen
+    timespec updateTime;
+};
+
+/// Start watching the library at path. The first call to LibraryChanged
+/// returns true so the initial load happens. Returns false if the
+/// fallback poller is in use.
+bool InitLibraryWatcher(LibraryWatcher* watcher, const char* path);
+/// Stop the watch thread and release its descriptors
+void CloseLibraryWatcher(LibraryWatcher* watcher);
+/// Returns true (once) if the library has been rewritten since the last call
+bool LibraryChanged(LibraryWatcher* watcher);
+/// Block for up to timeout, returning early if the library changes
+void WaitForLibraryChange(LibraryWatcher* watcher, std::chrono::nanoseconds timeout);
+
+#endif
@@ -0,0 +1,112 @@
+/* ==========================================================================
+   $File: MemoryRegions.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "MemoryRegions.hpp"
+#include <cstdio>
+
+struct RegionSpec
+{
+    RegionId id;
+    const char* name;
+    RegionLifetime lifetime;
+    HeapId heap;
+    MemoryIndex offset;
+    MemoryIndex size;
+};
+
+// NOTE(Chris): Item 0 of each plan is the heap root
+#define PERSISTANT_REGION(Index) HeapId::Persistant,                   \
+        PersistantHeapPlan::Offset<Index>(), PersistantHeapPlan::ItemSize<Index>()
+#define WORKING_REGION(Index) HeapId::Working,                          \
+        WorkingHeapPlan::Offset<Index>(), WorkingHeapPlan::ItemSize<Index>()
+
+FileScope constexpr RegionSpec regionSpecs[] =
+{
+    {Region_Permanent, "permanent", RegionLifetime::Permanent, PERSISTANT_REGION(1)},
+    {Region_Level, "level", RegionLifetime::Level, PERSISTANT_REGION(2)},
+    {Region_Frame, "frame", RegionLifetime::Frame, WORKING_REGION(1)},
+    {Region_GpuStaging, "gpu-staging", RegionLifetime::Transient, WORKING_REGION(2)},
+    {Region_Working, "working", RegionLifetime::Working, WORKING_REGION(3)},
+};
+static_assert(sizeof(regionSpecs) / sizeof(regionSpecs[0]) == Region_Count,
+              "Every RegionId needs a RegionSpec");
+static_assert(PersistantHeapPlan::NumItems + WorkingHeapPlan::NumItems == Region_Count + 2,
+              "Every region in the heap plans needs a RegionSpec");
+
+#undef PERSISTANT_REGION
+#undef WORKING_REGION
+
+FileScope const char* RegionLifetimeName(RegionLifetime lifetime)
+{
+    switch (lifetime)
+    {
+    case RegionLifetime::Permanent:
+        return "permanent";
+    case RegionLifetime::Level:
+        return "level";
+    case RegionLifetime::Frame:
+        return "frame";
+    case RegionLifetime::Transient:
+        return "transient";
+    case RegionLifetime::Working:
+        return "working";
+    }
+    return "unknown";
+}
+
+void InitMemoryRegions(CompleteState* state)
+{
+    for (const RegionSpec& spec : regionSpecs)
+    {
+        bool persistant = spec.heap == HeapId::Persistant;
+        u8* heap = static_cast<u8*>(persistant ? state->persistantHeap : state->workingHeap);
+        assert(spec.offset + spec.size
+               <= (persistant ? state->persistantHeapSize : state->workingHeapSize));
+
+        MemoryRegion* region = &state->regions[spec.id];
+        region->name = spec.name;
+        region->lifetime = spec.lifetime;
+        region->heap = spec.heap;
+        region->offset = spec.offset;
+        region->size = spec.size;
+        region->arena = reinterpret_cast<MemoryArena*>(heap + region->offset);
+
+        // NOTE(Chris): A fresh heap is zeroed, so this also catches
+        // regions that have never been initialised
+        MemoryArena* arena = region->arena;
+        u8* blockStart = heap + region->offset + RegionArenaOffset;
+        MemoryIndex arenaSize = spec.size - RegionArenaOffset;
+        if (arena->blockStart != blockStart || arena->size != arenaSize
+            || arena->growth != ArenaGrowth::Fixed || arena->fillPoint > arenaSize)
+        {
+            InitializeArena(arena, arenaSize, blockStart);
+        }
+        // NOTE(Chris): Snapshots read every page of the persistent heap,
+        // a guard page there would fault them
+        arena->noGuards = persistant;
+    }
+}
+
+void BeginFrameRegions(CompleteState* state)
+{
+    ResetRegions(state, RegionLifetime::Frame);
+}
+
+void PrintMemoryRegions(const CompleteState* state)
+{
+    for (u32 i = 0; i < Region_Count; ++i)
+    {
+        const MemoryRegion& region = state->regions[i];
+        if (!region.arena)
+            continue;
+        printf("Region %-12s (%-9s, %s heap): %8.2f of %7.2f MiB used\n",
+               region.name, RegionLifetimeName(region.lifetime),
+               region.heap == HeapId::Persistant ? "persistent" : "working",
+               (f64)GetArenaBytesUsed(region.arena) / Megabytes(1),
+               (f64)region.arena->size / Megabytes(1));
+    }
+}
@@ -0,0 +1,28 @@
+// -*- c++ -*-
+#if !defined(MEMORYREGIONS_H)
+/* ==========================================================================
+   $File: MemoryRegions.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Carves the CompleteState heaps into the regions published in
+   CompleteState::regions. Each region starts with its own MemoryArena,
+   the rest of the region is that arena's block. Persistent regions keep
+   their arenas across restarts (via snapshots), so an arena is only
+   reinitialised if it no longer matches where the region now is.
+   ========================================================================== */
+
+#define MEMORYREGIONS_H
+#include "LethaniGlobalDefines.h"
+#include "../libSrc/MemoryLayout.hpp"
+
+/// Fill in state->regions. The heaps must already be allocated. Also
+/// call after anything that replaces the heap contents.
+void InitMemoryRegions(CompleteState* state);
+/// Reset every Frame region, called before each Update
+void BeginFrameRegions(CompleteState* state);
+void PrintMemoryRegions(const CompleteState* state);
+
+#endif
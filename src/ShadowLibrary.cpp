@@ -0,0 +1,199 @@
+/* ==========================================================================
+   $File: ShadowLibrary.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "ShadowLibrary.hpp"
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#ifdef __linux__
+#include <elf.h>
+#include <link.h>
+#endif
+
+bool InitShadowLibrary(ShadowLibrary* shadow, const char* libraryPath)
+{
+    std::string path(libraryPath);
+    auto slash = path.find_last_of('/');
+    std::string fileName = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    auto dot = fileName.find('.');
+    shadow->stem = fileName.substr(0, dot);
+    shadow->extension = (dot == std::string::npos) ? "" : fileName.substr(dot);
+
+    const char* tmp = getenv("TMPDIR");
+    std::string dirTemplate = std::string((tmp && *tmp) ? tmp : "/tmp") + "/" + shadow->stem + ".XXXXXX";
+    std::vector<char> buf(dirTemplate.begin(), dirTemplate.end());
+    buf.push_back('\0');
+
+    if (mkdtemp(buf.data()) == nullptr)
+    {
+        shadow->dir.clear();
+        return false;
+    }
+    shadow->dir = buf.data();
+    return true;
+}
+
+void CloseShadowLibrary(ShadowLibrary* shadow)
+{
+    if (shadow->dir.empty())
+        return;
+
+    if (DIR* dir = opendir(shadow->dir.c_str()))
+    {
+        while (dirent* entry = readdir(dir))
+        {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                continue;
+            unlink((shadow->dir + "/" + entry->d_name).c_str());
+        }
+        closedir(dir);
+    }
+    rmdir(shadow->dir.c_str());
+    shadow->dir.clear();
+}
+
+std::string ShadowPath(const ShadowLibrary* shadow, u32 generation)
+{
+    return shadow->dir + "/" + shadow->stem + "." + std::to_string(generation) + shadow->extension;
+}
+
+bool CreateShadowCopy(const ShadowLibrary* shadow, const char* libraryPath, u32 generation)
+{
+    int src = open(libraryPath, O_RDONLY | O_CLOEXEC);
+    if (src < 0)
+        return false;
+
+    std::string destPath = ShadowPath(shadow, generation);
+    int dest = open(destPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0755);
+    if (dest < 0)
+    {
+        close(src);
+        return false;
+    }
+
+    bool ok = true;
+    char buf[64 * 1024];
+    while (true)
+    {
+        ssize_t len = read(src, buf, sizeof(buf));
+        if (len == 0)
+            break;
+        if (len < 0)
+        {
+            ok = false;
+            break;
+        }
+
+        for (ssize_t written = 0; written < len;)
+        {
+            ssize_t w = write(dest, buf + written, len - written);
+            if (w <= 0)
+            {
+                ok = false;
+                break;
+            }
+            written += w;
+        }
+        if (!ok)
+            break;
+    }
+
+    close(src);
+    if (close(dest) != 0)
+        ok = false;
+    if (!ok)
+        unlink(destPath.c_str());
+    return ok;
+}
+
+#ifdef __linux__
+FileScope bool ValidateElf(const u8* file, size_t size, const char* symbol)
+{
+    typedef ElfW(Ehdr) Ehdr;
+    typedef ElfW(Shdr) Shdr;
+    typedef ElfW(Sym) Sym;
+
+    if (size < sizeof(Ehdr))
+        return false;
+
+    const Ehdr* header = reinterpret_cast<const Ehdr*>(file);
+    if (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0
+        || header->e_ident[EI_CLASS] != (sizeof(void*) == 8 ? ELFCLASS64 : ELFCLASS32)
+        || header->e_type != ET_DYN
+        || header->e_shentsize != sizeof(Shdr))
+        return false;
+
+    // NOTE(Chris): The section headers are written last, so a truncated
+    // file is caught here
+    if (header->e_shoff == 0 || header->e_shoff + (size_t)header->e_shnum * sizeof(Shdr) > size)
+        return false;
+
+    const Shdr* sections = reinterpret_cast<const Shdr*>(file + header->e_shoff);
+    for (u32 i = 0; i < header->e_shnum; ++i)
+    {
+        const Shdr& symTab = sections[i];
+        if (symTab.sh_type != SHT_DYNSYM || symTab.sh_link >= header->e_shnum)
+            continue;
+
+        const Shdr& strTab = sections[symTab.sh_link];
+        if (symTab.sh_offset + symTab.sh_size > size || strTab.sh_offset + strTab.sh_size > size
+            || symTab.sh_entsize != sizeof(Sym))
+            return false;
+
+        const Sym* syms = reinterpret_cast<const Sym*>(file + symTab.sh_offset);
+        const char* strings = reinterpret_cast<const char*>(file + strTab.sh_offset);
+        size_t numSyms = symTab.sh_size / sizeof(Sym);
+        size_t symLen = strlen(symbol);
+        for (size_t s = 0; s < numSyms; ++s)
+        {
+            if (syms[s].st_shndx == SHN_UNDEF || syms[s].st_name + symLen >= strTab.sh_size)
+                continue;
+            if (memcmp(strings + syms[s].st_name, symbol, symLen + 1) == 0)
+                return true;
+        }
+        return false;
+    }
+    return false;
+}
+#endif
+
+bool ValidateLibraryFile(const char* path, const char* symbol)
+{
+#ifdef __linux__
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat fileData;
+    if (fstat(fd, &fileData) != 0 || fileData.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = (size_t)fileData.st_size;
+    void* file = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED)
+        return false;
+
+    bool valid = ValidateElf(static_cast<const u8*>(file), size, symbol);
+    munmap(file, size);
+    return valid;
+#else
+    // NOTE(Chris): No Mach-O parsing yet, the symbol lookup after
+    // loading still guards against a bad library
+    (void)symbol;
+    struct stat fileData;
+    return stat(path, &fileData) == 0 && fileData.st_size > 0;
+#endif
+}
@@ -0,0 +1,44 @@
+// -*- c++ -*-
+#if !defined(SHADOWLIBRARY_H)
+/* ==========================================================================
+   $File: ShadowLibrary.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Shadow copies of the hot-reloaded library. Rather than loading the
+   build output directly (which the linker may still be writing), each
+   generation is copied to libLoop.<gen>.so in a private temp directory
+   and checked before it's handed to the dynamic loader. The copy must
+   be a real copy, not a hardlink, as the loader identifies already
+   loaded objects by inode and would hand back the old generation.
+   ========================================================================== */
+
+#define SHADOWLIBRARY_H
+#include "LethaniGlobalDefines.h"
+#include <string>
+
+struct ShadowLibrary
+{
+    /// Private directory holding the copies, empty if not created
+    std::string dir;
+    /// Stem and extension of the source library, e.g. libLoop and .so
+    std::string stem;
+    std::string extension;
+};
+
+/// Create the temp directory for the shadow copies of libraryPath
+bool InitShadowLibrary(ShadowLibrary* shadow, const char* libraryPath);
+/// Remove the temp directory and any copies left in it
+void CloseShadowLibrary(ShadowLibrary* shadow);
+/// Path of the copy for a given generation
+std::string ShadowPath(const ShadowLibrary* shadow, u32 generation);
+/// Copy libraryPath to ShadowPath(generation), returns false on failure
+bool CreateShadowCopy(const ShadowLibrary* shadow, const char* libraryPath, u32 generation);
+/// Check that path is a complete shared object for this platform
+/// exporting symbol. Cheap enough to run before dlopen so we never
+/// load a half-written file.
+bool ValidateLibraryFile(const char* path, const char* symbol);
+
+#endif
@@ -0,0 +1,99 @@
+/* ==========================================================================
+   $File: StateMigration.cpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+
+#include "StateMigration.hpp"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+
+FileScope void WriteRootHeader(HeapRootHeader* header, const StructLayout& layout)
+{
+    ZeroBlock(header, sizeof(HeapRootHeader));
+    header->signature = layout.signature;
+    header->size = layout.size;
+    header->numFields = layout.numFields;
+    strncpy(header->name, layout.name, MaxLayoutName - 1);
+    for (u32 i = 0; i < layout.numFields; ++i)
+    {
+        PersistedField* field = &header->fields[i];
+        strncpy(field->name, layout.fields[i].name, MaxLayoutName - 1);
+        field->offset = layout.fields[i].offset;
+        field->size = layout.fields[i].size;
+        field->typeHash = layout.fields[i].typeHash;
+    }
+}
+
+FileScope const PersistedField* FindField(const HeapRootHeader* header, const char* name)
+{
+    for (u32 i = 0; i < header->numFields && i < MaxLayoutFields; ++i)
+    {
+        if (strncmp(header->fields[i].name, name, MaxLayoutName) == 0)
+            return &header->fields[i];
+    }
+    return nullptr;
+}
+
+u32 MigrateHeapRoots(CompleteState* state, const HeapRoot* roots, u32 numRoots)
+{
+    u32 migrated = 0;
+    for (u32 r = 0; r < numRoots; ++r)
+    {
+        const HeapRoot& root = roots[r];
+        const StructLayout& layout = root.layout();
+        HeapRootHeader* header = GetHeapRootHeader(state, root);
+        u8* data = static_cast<u8*>(GetHeapRootData(state, root));
+        MemoryIndex dataCapacity = root.capacity - HeapRootDataOffset;
+
+        if (header->signature == layout.signature && header->size == layout.size)
+            continue;
+
+        // NOTE(Chris): A fresh heap is zeroed, which is already a valid
+        // (uninitialised) instance of any layout
+        if (header->signature == 0)
+        {
+            WriteRootHeader(header, layout);
+            continue;
+        }
+
+        // NOTE(Chris): Old and new fields overlap in place, so work from
+        // a copy. A corrupt header can't make us read past the root
+        MemoryIndex oldSize = header->size < dataCapacity ? header->size : dataCapacity;
+        std::vector<u8> old(data, data + oldSize);
+        HeapRootHeader oldHeader;
+        CopyStruct(&oldHeader, header);
+
+        ZeroBlock(data, oldSize > layout.size ? oldSize : layout.size);
+        u32 kept = 0;
+        std::string reset;
+        for (u32 i = 0; i < layout.numFields; ++i)
+        {
+            const FieldLayout& field = layout.fields[i];
+            const PersistedField* prev = FindField(&oldHeader, field.name);
+            if (prev && prev->size == field.size && prev->typeHash == field.typeHash
+                && (MemoryIndex)prev->offset + prev->size <= oldSize)
+            {
+                CopyBlock(data + field.offset, old.data() + prev->offset, field.size);
+                ++kept;
+            }
+            else
+            {
+                reset += reset.empty() ? "" : ", ";
+                reset += field.name;
+            }
+        }
+        WriteRootHeader(header, layout);
+        ++migrated;
+
+        std::cout << "Migrated " << layout.name << " (" << oldSize << " -> " << layout.size
+                  << " bytes): kept " << kept << " fields";
+        if (!reset.empty())
+            std::cout << ", reset " << reset;
+        std::cout << std::endl;
+    }
+    return migrated;
+}
@@ -0,0 +1,24 @@
+// -*- c++ -*-
+#if !defined(STATEMIGRATION_H)
+/* ==========================================================================
+   $File: StateMigration.hpp $
+   $Version: 1.0 $
+   $Notice: (C) Copyright 2016 Chris Osborne. All Rights Reserved. $
+   $License: MIT: http://opensource.org/licenses/MIT $
+   ========================================================================== */
+/* ==========================================================================
+   Keeps the heap roots a library declares (see StateLayout.hpp) in the
+   layout that library was compiled with. Run before Reload, and after
+   anything that replaces the heap contents, as a snapshot may have been
+   taken with an older build.
+   ========================================================================== */
+
+#define STATEMIGRATION_H
+#include "LethaniGlobalDefines.h"
+#include "../libSrc/MemoryLayout.hpp"
+
+/// Bring every root up to date, returns the number that were migrated.
+/// Roots that have never been written just have their header filled in.
+u32 MigrateHeapRoots(CompleteState* state, const HeapRoot* roots, u32 numRoots);
+
+#endif
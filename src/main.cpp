@@ -8,12 +8,22 @@
 #include "LethaniGlobalDefines.h"
 #include "../libSrc/looper.hpp"
 #include "../libSrc/MemoryLayout.hpp"
-#include <sys/stat.h>
+#include "LibraryLoader.hpp"
+#include "FrameScheduler.hpp"
+#include "HostMemory.hpp"
+#include "HeapSnapshot.hpp"
+#include "InputLoop.hpp"
+#include "DirtyPageTracker.hpp"
+#include "StateMigration.hpp"
+#include "MemoryRegions.hpp"
 #include <SDL2/SDL.h>
 #include <string>
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
 
 #ifdef __APPLE__
 FileScope constexpr const char* libraryName = "bin/libLoop.dylib";
@@ -24,51 +34,211 @@ FileScope constexpr const char* libraryName = "bin/libLoop.so";
 struct Loop
 {
     void* handle;
-    time_t updateTime;
+    LibraryLoader loader;
+    /// Library currently in use, owned by the main thread
+    LoadedLibrary* lib;
     CompleteState* state;
     LoopAPI api;
-    MemoryIndex totalHeapSize;
-    void* heapMemory;
+    HostHeap heap;
+    /// Only valid if hasTracker
+    DirtyPageTracker tracker;
+    bool hasTracker;
+    const char* snapshotPath;
+    /// Opened on first use, fd < 0 until then
+    HeapSnapshot snapshot;
+    InputLoop inputLoop;
 };
 
 FileScope void LooperLoad(Loop* loop)
 {
-    // Duplicate lib first
+    // NOTE(Chris): Everything expensive (copy, dlopen, relocation,
+    // dlclose) happens on the loader thread, we just swap pointers
+    LoadedLibrary* lib = TakeLoadedLibrary(&loop->loader);
+    if (lib == nullptr)
+        return;
 
+    if (loop->lib)
+    {
+        loop->api.Unload(loop->state);
+        RetireLibrary(&loop->loader, loop->lib);
+    }
+
+    loop->lib = lib;
+    loop->handle = lib->handle;
+    loop->api = lib->api;
+    // NOTE(Chris): Before Reload, so the new code only ever sees its own layout
+    MigrateHeapRoots(loop->state, loop->api.roots, loop->api.numRoots);
+    // if (loop->state == nullptr)
+    //     loop->state = loop->api.Init();
+    loop->api.Reload(loop->state);
+}
+
+/// Whenever the persistent heap has been replaced, as it may have come
+/// from a previous build
+FileScope void LooperHeapRestored(Loop* loop)
+{
+    // NOTE(Chris): A restored snapshot is mapped over the persistent heap,
+    // replacing its huge page advice and NUMA policy along with the pages
+    CompleteState* state = loop->state;
+    AdviseHostHeap(&loop->heap, state->persistantHeap, state->persistantHeapSize);
+    if (state->numaNode >= 0)
+        BindMemoryToNumaNode(state->persistantHeap, state->persistantHeapSize, state->numaNode);
+
+    InitMemoryRegions(loop->state);
+    if (loop->lib)
+        MigrateHeapRoots(loop->state, loop->api.roots, loop->api.numRoots);
+}
 
-    struct stat libData;
-    if ((stat(libraryName, &libData) == 0) && (loop->updateTime != libData.st_mtime))
+FileScope bool LooperOpenSnapshot(Loop* loop)
+{
+    if (loop->snapshot.fd >= 0)
+        return true;
+
+    if (!OpenHeapSnapshot(&loop->snapshot, loop->snapshotPath,
+                          loop->state->persistantHeap, loop->state->persistantHeapSize,
+                          loop->hasTracker ? &loop->tracker : nullptr))
     {
-        if (loop->handle)
-        {
-            loop->api.Unload(loop->state);
-            SDL_UnloadObject(loop->handle);
-        }
-        void *handle = SDL_LoadObject(libraryName);
-        if (handle)
-        {
-            loop->handle = handle;
-            loop->updateTime = libData.st_mtime;
-            auto* api = reinterpret_cast<const LoopAPI*>(SDL_LoadFunction(loop->handle, "loopAPI"));
-            if (api != nullptr)
-            {
-                loop->api = *api;
-                // if (loop->state == nullptr)
-                //     loop->state = loop->api.Init();
-                loop->api.Reload(loop->state);
-            }
-            else
-            {
-                SDL_UnloadObject(loop->handle);
-                loop->handle = nullptr;
-                loop->updateTime = 0;
-            }
-        }
+        std::cout << "Unable to open snapshot " << loop->snapshotPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+FileScope void LooperSaveSnapshot(Loop* loop)
+{
+    if (!LooperOpenSnapshot(loop))
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    MemoryIndex pagesWritten = 0;
+    if (!SaveHeapSnapshot(&loop->snapshot, &pagesWritten))
+    {
+        std::cout << "Failed to write snapshot " << loop->snapshotPath << std::endl;
+        return;
+    }
+    std::chrono::duration<f64, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Saved snapshot (" << pagesWritten << " pages written) in "
+              << elapsed.count() << " ms" << std::endl;
+}
+
+FileScope void LooperRestoreSnapshot(Loop* loop)
+{
+    if (!LooperOpenSnapshot(loop))
+        return;
+
+    if (!CanRestoreHeapSnapshot(&loop->snapshot))
+    {
+        if (loop->snapshot.header.saveCount == 0)
+            std::cout << "No snapshot saved in " << loop->snapshotPath << std::endl;
         else
+            std::cout << "Snapshot was taken at heap address 0x" << std::hex
+                      << loop->snapshot.header.heapBase << std::dec
+                      << ", rerun with --heap-base to restore it" << std::endl;
+        return;
+    }
+
+    if (!RestoreHeapSnapshot(&loop->snapshot))
+    {
+        std::cout << "Failed to restore snapshot " << loop->snapshotPath << std::endl;
+        return;
+    }
+
+    LooperHeapRestored(loop);
+}
+
+FileScope void LooperCycleInputLoop(Loop* loop)
+{
+    InputLoop* inputLoop = &loop->inputLoop;
+    switch (inputLoop->mode)
+    {
+    case InputLoopMode::Idle:
+        if (BeginInputRecording(inputLoop, loop->state->persistantHeap,
+                                loop->state->persistantHeapSize))
+            std::cout << "Recording input loop" << std::endl;
+        else
+            std::cout << "Unable to snapshot heap for input loop" << std::endl;
+        break;
+
+    case InputLoopMode::Recording:
+        if (BeginInputPlayback(inputLoop))
         {
-            loop->handle = nullptr;
-            loop->updateTime = 0;
+            LooperHeapRestored(loop);
+            std::cout << "Playing input loop (" << inputLoop->numFrames << " frames)" << std::endl;
         }
+        else
+            std::cout << "Nothing recorded" << std::endl;
+        break;
+
+    case InputLoopMode::Playing:
+        StopInputLoop(inputLoop);
+        std::cout << "Stopped input loop" << std::endl;
+        break;
+    }
+}
+
+FileScope void LooperHandleRequests(Loop* loop)
+{
+    u32 requests = loop->state->hostRequests;
+    loop->state->hostRequests = HostRequest_None;
+
+    if (requests & HostRequest_SaveSnapshot)
+        LooperSaveSnapshot(loop);
+    if (requests & HostRequest_RestoreSnapshot)
+        LooperRestoreSnapshot(loop);
+    if (requests & HostRequest_CycleInputLoop)
+        LooperCycleInputLoop(loop);
+}
+
+FileScope bool LooperHotkey(Loop* loop, SDL_Keycode key)
+{
+    switch (key)
+    {
+    case SDLK_F5:
+        loop->state->hostRequests |= HostRequest_SaveSnapshot;
+        return true;
+    case SDLK_F6:
+        loop->state->hostRequests |= HostRequest_CycleInputLoop;
+        return true;
+    case SDLK_F9:
+        loop->state->hostRequests |= HostRequest_RestoreSnapshot;
+        return true;
+    default:
+        return false;
+    }
+}
+
+FileScope void LooperGatherInput(Loop* loop)
+{
+    FrameInput* input = &loop->state->input;
+    InputLoop* inputLoop = &loop->inputLoop;
+    input->numEvents = 0;
+
+    bool playing = inputLoop->mode == InputLoopMode::Playing;
+    if (playing)
+    {
+        // NOTE(Chris): The loop restarting brings back the heap as it was
+        // recorded, possibly by a previous build
+        if (PlaybackInputFrame(inputLoop, input, &loop->state->timing.frameSeconds))
+            LooperHeapRestored(loop);
+    }
+
+    // NOTE(Chris): Host hotkeys are never passed on (or recorded). While
+    // playing back, live input is dropped other than requests to quit
+    SDL_Event e;
+    while (input->numEvents < FrameInput::MaxEvents && SDL_PollEvent(&e) != 0)
+    {
+        if (e.type == SDL_KEYDOWN && !e.key.repeat && LooperHotkey(loop, e.key.keysym.sym))
+            continue;
+        if (playing && e.type != SDL_QUIT)
+            continue;
+        input->events[input->numEvents++] = e;
+    }
+
+    if (inputLoop->mode == InputLoopMode::Recording
+        && !RecordInputFrame(inputLoop, input, loop->state->timing.frameSeconds))
+    {
+        std::cout << "Input loop buffer full, ";
+        LooperCycleInputLoop(loop);
     }
 }
 
@@ -78,41 +248,236 @@ FileScope void LooperUnload(Loop* loop)
     {
         loop->api.Close(loop->state);
         loop->state = nullptr;
-        SDL_UnloadObject(loop->handle);
+        RetireLibrary(&loop->loader, loop->lib);
+        loop->lib = nullptr;
         loop->handle = nullptr;
-        loop->updateTime = 0;
     }
 }
 
-int main(void)
+struct HostOptions
 {
+    FramePacing pacing;
+    f64 targetHz;
+    HeapPages heapPages;
+    /// Non-null to reserve the heaps at a fixed address
+    void* heapBase;
+    const char* snapshotPath;
+    /// Restore the snapshot before the first frame
+    bool restoreSnapshot;
+    /// Count the pages written each frame
+    bool dirtyStats;
+    /// Keep the main thread and persistent heap on one NUMA node
+    bool numa;
+};
+
+FileScope HostOptions ParseHostOptions(int argc, char* argv[])
+{
+    HostOptions opts;
+    opts.pacing = FramePacing::Fixed;
+    opts.targetHz = 60.0;
+    opts.heapPages = HeapPages::Transparent;
+    opts.heapBase = nullptr;
+    opts.snapshotPath = "loop.snapshot";
+    opts.restoreSnapshot = false;
+    opts.dirtyStats = false;
+    opts.numa = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+        {
+            opts.pacing = FramePacing::Fixed;
+            opts.targetHz = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--vsync") == 0)
+        {
+            opts.pacing = FramePacing::VSync;
+        }
+        else if (strcmp(argv[i], "--uncapped") == 0)
+        {
+            opts.pacing = FramePacing::Uncapped;
+        }
+        else if (strcmp(argv[i], "--heap-pages") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "normal") == 0)
+                opts.heapPages = HeapPages::Normal;
+            else if (strcmp(argv[i], "thp") == 0)
+                opts.heapPages = HeapPages::Transparent;
+            else if (strcmp(argv[i], "hugetlb") == 0)
+                opts.heapPages = HeapPages::HugeTLB;
+            else
+                std::cout << "Unknown page type: " << argv[i] << std::endl;
+        }
+        else if (strcmp(argv[i], "--fixed-heap") == 0)
+        {
+            opts.heapBase = reinterpret_cast<void*>(DefaultFixedHeapBase);
+        }
+        else if (strcmp(argv[i], "--heap-base") == 0 && i + 1 < argc)
+        {
+            opts.heapBase = reinterpret_cast<void*>(strtoull(argv[++i], nullptr, 0));
+        }
+        else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc)
+        {
+            opts.snapshotPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--restore") == 0)
+        {
+            opts.restoreSnapshot = true;
+        }
+        else if (strcmp(argv[i], "--dirty-stats") == 0)
+        {
+            opts.dirtyStats = true;
+        }
+        else if (strcmp(argv[i], "--numa") == 0)
+        {
+            opts.numa = true;
+        }
+        else
+        {
+            std::cout << "Unknown option: " << argv[i] << std::endl;
+            std::cout << "Usage: " << argv[0] << " [--fps hz | --vsync | --uncapped]"
+                      << " [--heap-pages normal|thp|hugetlb]"
+                      << " [--fixed-heap | --heap-base addr]"
+                      << " [--snapshot file] [--restore] [--dirty-stats] [--numa]" << std::endl;
+        }
+    }
+
+    if (opts.pacing == FramePacing::Fixed && opts.targetHz <= 0.0)
+        opts.pacing = FramePacing::Uncapped;
+
+    return opts;
+}
+
+int main(int argc, char* argv[])
+{
+    HostOptions opts = ParseHostOptions(argc, argv);
+
     CompleteState libState{};
-    libState.persistantHeapSize = Megabytes(128);
-    libState.workingHeapSize = Megabytes(128);
+    libState.persistantHeapSize = PersistantHeapSize;
+    libState.workingHeapSize = WorkingHeapSize;
 
     Loop loop{};
-    loop.totalHeapSize = libState.persistantHeapSize + libState.workingHeapSize;
-    loop.heapMemory = calloc(loop.totalHeapSize, sizeof(u8));
+    // NOTE(Chris): mmap'd, so only the pages we touch are ever zeroed/faulted
+    MemoryIndex heapSize = libState.persistantHeapSize + libState.workingHeapSize;
+    bool heapReserved = AllocateHostHeap(&loop.heap, heapSize, opts.heapPages, opts.heapBase);
+    if (!heapReserved && opts.heapBase)
+    {
+        std::cout << "Unable to reserve heap at " << opts.heapBase
+                  << ", persistent pointers won't survive a restart" << std::endl;
+        heapReserved = AllocateHostHeap(&loop.heap, heapSize, opts.heapPages);
+    }
+    if (!heapReserved)
+    {
+        std::cout << "Unable to reserve heap memory" << std::endl;
+        return 1;
+    }
 
-    libState.persistantHeap = loop.heapMemory;
+    libState.persistantHeap = loop.heap.base;
     libState.workingHeap = (void*)((u8*)libState.persistantHeap + libState.persistantHeapSize);
 
+    libState.sessionId = ((u64)getpid() << 32)
+        ^ (u64)std::chrono::system_clock::now().time_since_epoch().count();
+
+    // NOTE(Chris): Has to happen before anything touches the heap. The
+    // working heap is left to first touch, so per-thread memory ends up
+    // on the node of whichever thread uses it
+    libState.numaNode = -1;
+    if (opts.numa)
+    {
+        i32 node = CurrentNumaNode();
+        if (!PinThreadToNumaNode(node))
+            std::cout << "Unable to pin the main thread to NUMA node " << node << std::endl;
+        if (BindMemoryToNumaNode(libState.persistantHeap, libState.persistantHeapSize, node))
+            libState.numaNode = node;
+        else
+            std::cout << "NUMA policies unsupported, heap left to first touch" << std::endl;
+    }
+    InitMemoryRegions(&libState);
+
+    // NOTE(Chris): Soft-dirty bits aren't reliable on hugetlbfs pages,
+    // the snapshots fall back to hashing every page there
+    if (loop.heap.pages != HeapPages::HugeTLB)
+        loop.hasTracker = InitDirtyPageTracker(&loop.tracker, loop.heap.base, loop.heap.size);
+    if (!loop.hasTracker && opts.dirtyStats)
+        std::cout << "Soft-dirty page tracking unavailable, no dirty page stats" << std::endl;
+
     loop.state = &libState;
+    loop.snapshotPath = opts.snapshotPath;
+    loop.snapshot.fd = -1;
+    InitInputLoop(&loop.inputLoop, opts.snapshotPath, Megabytes(16),
+                  loop.hasTracker ? &loop.tracker : nullptr);
+    if (opts.restoreSnapshot)
+        LooperRestoreSnapshot(&loop);
+
+    InitLibraryLoader(&loop.loader, libraryName);
+
+    FrameScheduler scheduler;
+    InitFrameScheduler(&scheduler, &libState.timing, opts.pacing, opts.targetHz);
 
     while (true)
     {
         LooperLoad(&loop);
         if (loop.handle != nullptr)
         {
-            if (!loop.api.Update(loop.state))
+            LooperGatherInput(&loop);
+            BeginFrameRegions(loop.state);
+            BeginUpdate(&scheduler);
+            bool running = loop.api.Update(loop.state);
+            EndUpdate(&scheduler, &libState.timing);
+            if (!running)
                 break;
+
+            if (opts.dirtyStats && loop.hasTracker)
+            {
+                SampleDirtyPages(&loop.tracker);
+                libState.timing.persistantDirtyPages =
+                    CountDirtyPages(&loop.tracker, libState.persistantHeap, libState.persistantHeapSize);
+                libState.timing.workingDirtyPages =
+                    CountDirtyPages(&loop.tracker, libState.workingHeap, libState.workingHeapSize);
+            }
+
+            LooperHandleRequests(&loop);
+
+            WaitForNextFrame(&scheduler, &libState.timing, &loop.loader);
         }
         else
         {
-            std::cout << SDL_GetError() << std::endl;
+            // NOTE(Chris): Nothing loaded yet, the loader reports why.
+            // Wakes early once a library is ready
+            WaitForLoadedLibrary(&loop.loader, std::chrono::milliseconds(100));
+            ResyncFrameScheduler(&scheduler);
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     LooperUnload(&loop);
+    CloseLibraryLoader(&loop.loader);
+    CloseHeapSnapshot(&loop.snapshot);
+    CloseInputLoop(&loop.inputLoop);
+    if (loop.hasTracker)
+        CloseDirtyPageTracker(&loop.tracker);
+
+    PrintMemoryRegions(&libState);
+    HostHeapStats heapStats = QueryHostHeapStats(&loop.heap);
+    std::cout << "Heap (" << HeapPagesName(loop.heap.pages) << " pages): "
+              << heapStats.resident / Megabytes(1) << " of "
+              << heapStats.reserved / Megabytes(1) << " MiB resident, "
+              << heapStats.hugePageBytes / Megabytes(1) << " MiB in huge pages" << std::endl;
+    if (opts.numa)
+    {
+        i32 node = libState.numaNode >= 0 ? libState.numaNode : CurrentNumaNode();
+        HostNumaStats persistant =
+            QueryHostNumaStats(libState.persistantHeap, libState.persistantHeapSize, node);
+        HostNumaStats working =
+            QueryHostNumaStats(libState.workingHeap, libState.workingHeapSize, node);
+        auto remotePercent = [](const HostNumaStats& stats)
+        {
+            MemoryIndex total = stats.localBytes + stats.remoteBytes;
+            return total ? 100.0 * stats.remoteBytes / total : 0.0;
+        };
+        std::cout << "NUMA node " << node << ": " << remotePercent(persistant)
+                  << "% of persistent heap and " << remotePercent(working)
+                  << "% of working heap remote" << std::endl;
+    }
+    FreeHostHeap(&loop.heap);
     return 0;
 }